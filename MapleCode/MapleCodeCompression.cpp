@@ -0,0 +1,409 @@
+#include "MapleCodeCompression.h"
+#include "MapleCodeInternal.h"
+#include <algorithm>
+#include <iterator>
+
+using namespace MapleCode::Reader;
+using namespace MapleCode::Reader::Internal;
+
+namespace
+{
+	const std::uint8_t BlockStored = 0;
+	const std::uint8_t BlockLZ = 1;
+	const std::uint32_t MinMatch = 4;
+	const std::uint32_t HashBits = 12;
+	const std::uint32_t NoPosition = 0xFFFFFFFF;
+
+	//LZ block format: a sequence of (token, literal length extension, literals, match offset,
+	//match length extension). The high nibble of the token is the literal length and the low
+	//nibble the match length minus MinMatch; a nibble of 15 is followed by extension bytes
+	//that are added until one is below 255. The last sequence has literals only.
+	void AppendLength(std::vector<std::uint8_t>& output, std::uint32_t length)
+	{
+		for (; length >= 255; length -= 255)
+		{
+			output.push_back(255);
+		}
+		output.push_back(static_cast<std::uint8_t>(length));
+	}
+
+	void AppendSequence(std::vector<std::uint8_t>& output, const std::uint8_t* literals, std::uint32_t literalLength,
+		std::uint32_t matchOffset, std::uint32_t matchLength)
+	{
+		bool last = matchLength == 0;
+		std::uint32_t matchCode = last ? 0 : matchLength - MinMatch;
+		output.push_back(static_cast<std::uint8_t>(std::min(literalLength, 15u) << 4 | std::min(matchCode, 15u)));
+		if (literalLength >= 15)
+		{
+			AppendLength(output, literalLength - 15);
+		}
+		output.insert(output.end(), literals, literals + literalLength);
+		if (last)
+		{
+			return;
+		}
+		output.push_back(static_cast<std::uint8_t>(matchOffset));
+		output.push_back(static_cast<std::uint8_t>(matchOffset >> 8));
+		if (matchCode >= 15)
+		{
+			AppendLength(output, matchCode - 15);
+		}
+	}
+
+	void CompressBlock(const std::uint8_t* data, std::uint32_t length, std::vector<std::uint8_t>& output)
+	{
+		std::vector<std::uint32_t> table(std::size_t{ 1 } << HashBits, NoPosition);
+		std::uint32_t anchor = 0, pos = 0;
+		while (pos + MinMatch <= length)
+		{
+			std::uint32_t sequence;
+			std::memcpy(&sequence, data + pos, 4);
+			auto hash = (sequence * 2654435761u) >> (32 - HashBits);
+			auto candidate = table[hash];
+			table[hash] = pos;
+			if (candidate == NoPosition || pos - candidate > 0xFFFF || std::memcmp(data + candidate, data + pos, 4) != 0)
+			{
+				++pos;
+				continue;
+			}
+			auto matchLength = MinMatch;
+			while (pos + matchLength < length && data[candidate + matchLength] == data[pos + matchLength])
+			{
+				++matchLength;
+			}
+			AppendSequence(output, data + anchor, pos - anchor, pos - candidate, matchLength);
+			pos += matchLength;
+			anchor = pos;
+		}
+		AppendSequence(output, data + anchor, length - anchor, 0, 0);
+	}
+
+	std::uint32_t ReadLength(const std::uint8_t*& input, const std::uint8_t* inputEnd, std::uint32_t length)
+	{
+		if (length != 15)
+		{
+			return length;
+		}
+		std::uint8_t b;
+		do
+		{
+			if (input == inputEnd)
+			{
+				throw ReaderException("Invalid compressed data");
+			}
+			b = *input++;
+			length += b;
+		} while (b == 255);
+		return length;
+	}
+
+	void DecompressBlock(const std::uint8_t* input, const std::uint8_t* inputEnd, std::uint8_t* output,
+		std::uint32_t outputLength)
+	{
+		std::uint32_t pos = 0;
+		while (true)
+		{
+			if (input == inputEnd)
+			{
+				throw ReaderException("Invalid compressed data");
+			}
+			auto token = *input++;
+			auto literalLength = ReadLength(input, inputEnd, token >> 4);
+			if (literalLength > static_cast<std::uint32_t>(inputEnd - input) || literalLength > outputLength - pos)
+			{
+				throw ReaderException("Invalid compressed data");
+			}
+			std::memcpy(output + pos, input, literalLength);
+			input += literalLength;
+			pos += literalLength;
+			if (input == inputEnd)
+			{
+				break;
+			}
+
+			if (inputEnd - input < 2)
+			{
+				throw ReaderException("Invalid compressed data");
+			}
+			std::uint32_t matchOffset = input[0] | input[1] << 8;
+			input += 2;
+			auto matchLength = ReadLength(input, inputEnd, token & 15) + MinMatch;
+			if (matchOffset == 0 || matchOffset > pos || matchLength > outputLength - pos)
+			{
+				throw ReaderException("Invalid compressed data");
+			}
+			//Byte by byte, as the match may overlap the bytes it produces.
+			for (std::uint32_t i = 0; i < matchLength; ++i, ++pos)
+			{
+				output[pos] = output[pos - matchOffset];
+			}
+		}
+		if (pos != outputLength)
+		{
+			throw ReaderException("Invalid compressed data");
+		}
+	}
+}
+
+CompressedDataSection::CompressedDataSection(const std::uint8_t* payload, std::uint32_t available,
+	std::uint32_t dataLength, std::pmr::memory_resource* resource)
+	: _payload(payload), _payloadLength(MeasurePayload(payload, available, dataLength)), _dataLength(dataLength),
+	_cache(resource)
+{
+	std::uint32_t pos = 0;
+	_blockSize = ReadNumberU(payload, &pos, 4);
+	_blockCount = (dataLength + _blockSize - 1) / _blockSize;
+	SetCacheCapacity(DefaultCacheBlocks);
+}
+
+std::uint32_t CompressedDataSection::MeasurePayload(const std::uint8_t* payload, std::uint32_t available,
+	std::uint32_t dataLength)
+{
+	std::uint32_t pos = 0;
+	if (available < 4)
+	{
+		throw ReaderException("Invalid compressed data");
+	}
+	auto blockSize = ReadNumberU(payload, &pos, 4);
+	if (blockSize == 0 || blockSize > MaxBlockSize)
+	{
+		throw ReaderException("Invalid compressed data");
+	}
+	auto blockCount = (dataLength + blockSize - 1) / blockSize;
+
+	std::uint64_t tableEnd = 4 + (std::uint64_t{ blockCount } + 1) * 4;
+	if (tableEnd > available)
+	{
+		throw ReaderException("Invalid compressed data");
+	}
+	auto getBlockOffset = [&](std::uint32_t block)
+	{
+		std::uint32_t offsetPos = 4 + block * 4;
+		return ReadNumberU(payload, &offsetPos, 4);
+	};
+	for (std::uint32_t i = 0; i < blockCount; ++i)
+	{
+		if (getBlockOffset(i) >= getBlockOffset(i + 1))
+		{
+			throw ReaderException("Invalid compressed data");
+		}
+	}
+	std::uint64_t payloadLength = tableEnd + getBlockOffset(blockCount);
+	if (payloadLength > available)
+	{
+		throw ReaderException("Invalid compressed data");
+	}
+	return static_cast<std::uint32_t>(payloadLength);
+}
+
+std::uint32_t CompressedDataSection::GetBlockOffset(std::uint32_t block) const
+{
+	std::uint32_t pos = 4 + block * 4;
+	return ReadNumberU(_payload, &pos, 4);
+}
+
+void CompressedDataSection::SetCacheCapacity(std::size_t blocks)
+{
+	std::lock_guard<std::mutex> lock(_cacheLock);
+	_cacheCapacity = std::min<std::size_t>(blocks == 0 ? 1 : blocks, _blockCount);
+	while (_cache.size() < _cacheCapacity)
+	{
+		_cache.emplace_back(_cache.get_allocator().resource());
+		_cache.back().Data.reserve(std::min(_blockSize, _dataLength));
+	}
+	TrimUnpinned();
+	_entryUnpinned.notify_all();
+}
+
+void CompressedDataSection::DecodeBlock(std::uint32_t block, std::uint8_t* output, std::uint32_t length) const
+{
+	auto tableEnd = 4 + (_blockCount + 1) * 4;
+	auto input = _payload + tableEnd + GetBlockOffset(block);
+	auto inputEnd = _payload + tableEnd + GetBlockOffset(block + 1);
+
+	auto method = *input++;
+	if (method == BlockStored)
+	{
+		if (static_cast<std::uint32_t>(inputEnd - input) != length)
+		{
+			throw ReaderException("Invalid compressed data");
+		}
+		std::memcpy(output, input, length);
+	}
+	else if (method == BlockLZ)
+	{
+		DecompressBlock(input, inputEnd, output, length);
+	}
+	else
+	{
+		throw ReaderException("Invalid compressed data");
+	}
+}
+
+//Must be called with _cacheLock held. Pinned entries are kept even above the capacity.
+void CompressedDataSection::TrimUnpinned() const
+{
+	for (auto it = _cache.end(); _cache.size() > _cacheCapacity && it != _cache.begin(); )
+	{
+		--it;
+		if (it->Pins == 0)
+		{
+			it = _cache.erase(it);
+		}
+	}
+}
+
+//Returns the decompressed block, which stays valid until UnpinBlock.
+CompressedDataSection::CacheEntry* CompressedDataSection::PinBlock(std::uint32_t block) const
+{
+	CacheEntry* entry = nullptr;
+	{
+		std::unique_lock<std::mutex> lock(_cacheLock);
+		while (entry == nullptr)
+		{
+			auto it = std::find_if(_cache.begin(), _cache.end(), [&](const CacheEntry& e) { return e.Block == block; });
+			if (it == _cache.end())
+			{
+				//Reuse the least recently used entry that no reader holds.
+				auto unpinned = std::find_if(_cache.rbegin(), _cache.rend(), [](const CacheEntry& e) { return e.Pins == 0; });
+				if (unpinned == _cache.rend())
+				{
+					_entryUnpinned.wait(lock);
+					continue;
+				}
+				it = std::prev(unpinned.base());
+				it->Block = block;
+				it->Ready.store(false, std::memory_order_relaxed);
+				//Within the reserved capacity, so this does not allocate.
+				it->Data.resize(std::min(_blockSize, _dataLength - block * _blockSize));
+			}
+			_cache.splice(_cache.begin(), _cache, it);
+			entry = &*it;
+			entry->Pins += 1;
+		}
+	}
+
+	if (!entry->Ready.load(std::memory_order_acquire))
+	{
+		try
+		{
+			std::lock_guard<std::mutex> decodeLock(entry->DecodeLock);
+			if (!entry->Ready.load(std::memory_order_relaxed))
+			{
+				DecodeBlock(block, entry->Data.data(), static_cast<std::uint32_t>(entry->Data.size()));
+				entry->Ready.store(true, std::memory_order_release);
+			}
+		}
+		catch (...)
+		{
+			UnpinBlock(entry);
+			throw;
+		}
+	}
+	return entry;
+}
+
+void CompressedDataSection::UnpinBlock(CacheEntry* entry) const
+{
+	std::lock_guard<std::mutex> lock(_cacheLock);
+	entry->Pins -= 1;
+	if (entry->Pins == 0)
+	{
+		TrimUnpinned();
+		_entryUnpinned.notify_all();
+	}
+}
+
+void CompressedDataSection::Read(std::uint32_t begin, std::uint32_t end, void* buffer) const
+{
+	if (end < begin || end > _dataLength)
+	{
+		throw ReaderException("Invalid data offset");
+	}
+	auto output = static_cast<std::uint8_t*>(buffer);
+	while (begin < end)
+	{
+		auto block = begin / _blockSize;
+		auto blockStart = block * _blockSize;
+		auto entry = PinBlock(block);
+		auto& data = entry->Data;
+		auto len = std::min<std::uint32_t>(end - begin, static_cast<std::uint32_t>(data.size()) - (begin - blockStart));
+		std::memcpy(output, data.data() + (begin - blockStart), len);
+		UnpinBlock(entry);
+		output += len;
+		begin += len;
+	}
+}
+
+bool CompressedDataSection::ReadString(std::uint32_t begin, std::string& result) const
+{
+	result.clear();
+	while (begin < _dataLength)
+	{
+		auto block = begin / _blockSize;
+		auto blockStart = block * _blockSize;
+		auto entry = PinBlock(block);
+		auto& data = entry->Data;
+		auto start = data.data() + (begin - blockStart);
+		auto blockEnd = data.data() + data.size();
+		auto terminator = std::find(start, blockEnd, std::uint8_t{ 0 });
+		auto found = terminator != blockEnd;
+		auto nextBlock = blockStart + static_cast<std::uint32_t>(data.size());
+		try
+		{
+			result.append(start, terminator);
+		}
+		catch (...)
+		{
+			UnpinBlock(entry);
+			throw;
+		}
+		UnpinBlock(entry);
+		if (found)
+		{
+			return true;
+		}
+		begin = nextBlock;
+	}
+	return false;
+}
+
+std::vector<std::uint8_t> CompressedDataSection::Compress(const std::uint8_t* data, std::uint32_t length,
+	std::uint32_t blockSize)
+{
+	if (blockSize == 0 || blockSize > MaxBlockSize)
+	{
+		throw ReaderException("Invalid block size");
+	}
+	std::uint32_t blockCount = (length + blockSize - 1) / blockSize;
+	std::vector<std::uint8_t> output;
+	AppendNumber(output, blockSize, 4);
+	auto tablePos = output.size();
+	output.resize(tablePos + (blockCount + 1) * 4);
+	auto blocksStart = output.size();
+
+	std::vector<std::uint8_t> compressed;
+	for (std::uint32_t block = 0; block < blockCount; ++block)
+	{
+		std::uint32_t offset = static_cast<std::uint32_t>(output.size() - blocksStart);
+		std::memcpy(output.data() + tablePos + block * 4, &offset, 4);
+
+		auto blockStart = block * blockSize;
+		auto blockLength = std::min(blockSize, length - blockStart);
+		compressed.clear();
+		CompressBlock(data + blockStart, blockLength, compressed);
+		if (compressed.size() < blockLength)
+		{
+			output.push_back(BlockLZ);
+			output.insert(output.end(), compressed.begin(), compressed.end());
+		}
+		else
+		{
+			output.push_back(BlockStored);
+			output.insert(output.end(), data + blockStart, data + blockStart + blockLength);
+		}
+	}
+	std::uint32_t end = static_cast<std::uint32_t>(output.size() - blocksStart);
+	std::memcpy(output.data() + tablePos + blockCount * 4, &end, 4);
+	return output;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "MapleCodeReader.h"
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <memory_resource>
+#include <mutex>
+
+namespace MapleCode::Reader
+{
+	//A data section stored as independently compressed blocks, so that reading a string or
+	//DAT payload only decompresses the blocks it overlaps. Decompressed blocks are kept in a
+	//small LRU cache shared by all readers of the document. Blocks are decompressed outside
+	//the cache lock, so readers of different blocks do not wait for each other.
+	//
+	//The cache entries and their buffers are allocated when the section is created or its
+	//capacity changes, and reused for other blocks afterwards. Reading never allocates, so
+	//memory stays bounded in a monotonic arena and reads can run while other threads use
+	//the same memory resource.
+	//
+	//Layout (little-endian):
+	//  u32 BlockSize                      uncompressed size of every block except the last
+	//  u32 BlockOffsets[block count + 1]  block positions relative to the end of this table
+	//  blocks                             method byte (0 stored, 1 LZ) followed by the block data
+	//The block count follows from the uncompressed data length in the document header.
+	class CompressedDataSection
+	{
+	private:
+		static const std::uint32_t NoBlock = 0xFFFFFFFF;
+
+		//An entry is pinned while a reader uses it and is only reused for another block when
+		//unpinned. Data has room for a whole block and is filled by the first reader under
+		//DecodeLock.
+		struct CacheEntry
+		{
+			std::uint32_t Block = NoBlock;
+			std::uint32_t Pins = 0;
+			std::atomic<bool> Ready{ false };
+			std::mutex DecodeLock;
+			std::pmr::vector<std::uint8_t> Data;
+
+			explicit CacheEntry(std::pmr::memory_resource* resource)
+				: Data(resource)
+			{
+			}
+		};
+
+		const std::uint8_t* _payload;
+		std::uint32_t _payloadLength;
+		std::uint32_t _dataLength;
+		std::uint32_t _blockSize;
+		std::uint32_t _blockCount;
+
+		//Entries in LRU order. The capacity is small, so blocks are looked up by a linear scan.
+		mutable std::mutex _cacheLock;
+		mutable std::condition_variable _entryUnpinned;
+		mutable std::pmr::list<CacheEntry> _cache;
+		std::size_t _cacheCapacity = 0;
+
+		std::uint32_t GetBlockOffset(std::uint32_t block) const;
+		void DecodeBlock(std::uint32_t block, std::uint8_t* output, std::uint32_t length) const;
+		void TrimUnpinned() const;
+		CacheEntry* PinBlock(std::uint32_t block) const;
+		void UnpinBlock(CacheEntry* entry) const;
+
+	public:
+		static const std::uint32_t DefaultBlockSize = 16384;
+		static const std::uint32_t MaxBlockSize = 65536;
+		static const std::size_t DefaultCacheBlocks = 16;
+
+		//Validates the block table. available is the number of bytes readable at payload.
+		//The cache is allocated from the given memory resource.
+		CompressedDataSection(const std::uint8_t* payload, std::uint32_t available, std::uint32_t dataLength,
+			std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		//Validates the block table and returns the payload length without allocating a cache.
+		static std::uint32_t MeasurePayload(const std::uint8_t* payload, std::uint32_t available,
+			std::uint32_t dataLength);
+
+		std::uint32_t GetPayloadLength() const { return _payloadLength; }
+		std::uint32_t GetBlockSize() const { return _blockSize; }
+
+		//Allocates or frees cache entries, so unlike reading it must not run while other
+		//threads use a memory resource that is not thread-safe. Readers wait while every
+		//entry is pinned.
+		void SetCacheCapacity(std::size_t blocks);
+
+		//Copy bytes [begin, end) of the uncompressed data section.
+		void Read(std::uint32_t begin, std::uint32_t end, void* buffer) const;
+
+		//Read a zero-terminated string starting at begin. Returns false if the data section
+		//ends before the terminator.
+		bool ReadString(std::uint32_t begin, std::string& result) const;
+
+		static std::vector<std::uint8_t> Compress(const std::uint8_t* data, std::uint32_t length,
+			std::uint32_t blockSize = DefaultBlockSize);
+	};
+}
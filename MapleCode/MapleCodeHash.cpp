@@ -0,0 +1,279 @@
+#include "MapleCodeHash.h"
+#include "MapleCodeInternal.h"
+#include <algorithm>
+
+using namespace MapleCode::Reader;
+using namespace MapleCode::Reader::Internal;
+
+static const std::uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+static const std::uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+static const std::uint64_t Prime3 = 0x165667B19E3779F9ull;
+static const std::uint64_t Prime4 = 0x85EBCA77C2B2AE63ull;
+static const std::uint64_t Prime5 = 0x27D4EB2F165667C5ull;
+
+static inline std::uint64_t Rotl(std::uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline std::uint64_t Read64(const std::uint8_t* p)
+{
+	std::uint64_t ret;
+	std::memcpy(&ret, p, 8);
+	return ret;
+}
+
+static inline std::uint64_t Round(std::uint64_t acc, std::uint64_t input)
+{
+	acc += input * Prime2;
+	acc = Rotl(acc, 31);
+	return acc * Prime1;
+}
+
+static inline std::uint64_t Avalanche(std::uint64_t h)
+{
+	h ^= h >> 33;
+	h *= Prime2;
+	h ^= h >> 29;
+	h *= Prime3;
+	h ^= h >> 32;
+	return h;
+}
+
+NodeHash MapleCode::Reader::HashBytes(const void* data, std::size_t length, std::uint64_t seed)
+{
+	auto p = static_cast<const std::uint8_t*>(data);
+	auto end = p + length;
+
+	//Four independent lanes over 32-byte stripes, so the main loop has no dependency
+	//between lanes and can be vectorized or pipelined by the compiler.
+	std::uint64_t acc[4] = { seed + Prime1 + Prime2, seed + Prime2, seed, seed - Prime1 };
+	while (end - p >= 32)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			acc[i] = Round(acc[i], Read64(p + i * 8));
+		}
+		p += 32;
+	}
+
+	std::uint64_t low = Rotl(acc[0], 1) + Rotl(acc[1], 7) + Rotl(acc[2], 12) + Rotl(acc[3], 18);
+	std::uint64_t high = Rotl(acc[0], 18) ^ Rotl(acc[1], 12) ^ Rotl(acc[2], 7) ^ Rotl(acc[3], 1);
+	low += length;
+	high += length * Prime5;
+
+	while (end - p >= 8)
+	{
+		auto k = Round(0, Read64(p));
+		low = Rotl(low ^ k, 27) * Prime1 + Prime4;
+		high = Rotl(high + k, 31) * Prime2 + Prime3;
+		p += 8;
+	}
+	while (p < end)
+	{
+		low = Rotl(low ^ (*p * Prime5), 11) * Prime1;
+		high = Rotl(high + (*p * Prime1), 13) * Prime4;
+		++p;
+	}
+
+	NodeHash ret;
+	ret.Low = Avalanche(low ^ Rotl(high, 32));
+	ret.High = Avalanche(high + ret.Low * Prime3);
+	return ret;
+}
+
+static void AppendHash(std::vector<std::uint64_t>& words, const NodeHash& hash)
+{
+	words.push_back(hash.Low);
+	words.push_back(hash.High);
+}
+
+static std::uint32_t FindOrdinal(const std::pmr::vector<std::uint32_t>& offsets, std::uint32_t offset)
+{
+	auto it = std::lower_bound(offsets.begin(), offsets.end(), offset);
+	if (it == offsets.end() || *it != offset)
+	{
+		throw ReaderException("Invalid node data");
+	}
+	return static_cast<std::uint32_t>(it - offsets.begin());
+}
+
+NodeHashTable NodeHashTable::Compute(Document* doc)
+{
+	auto data = doc->GetDocumentData();
+	auto content = data->Content;
+	auto nodeLength = data->NodeRange.GetLength();
+
+	NodeHashTable ret(data->Resource);
+	ret._document = data;
+	std::vector<std::uint8_t> dataBuffer;
+
+	std::vector<NodeHash> strHashes;
+	auto stringCount = data->GetStringCount();
+	strHashes.reserve(stringCount);
+	for (std::uint32_t i = 0; i < stringCount; ++i)
+	{
+		auto str = data->GetString(i);
+		strHashes.push_back(HashBytes(str.data(), str.size()));
+	}
+
+	std::vector<NodeHash> typeHashes;
+	typeHashes.reserve(data->TypeList.size());
+	for (auto& type : data->TypeList)
+	{
+		auto name = type.GetName();
+		auto& args = type.GetArgumentTypes();
+		std::vector<std::uint8_t> typeData(name.begin(), name.end());
+		typeData.push_back(0);
+		typeData.push_back(static_cast<std::uint8_t>(type.GetGenericArgCount()));
+		typeData.push_back(type.HasChildren() ? 1 : 0);
+		for (auto tt : args)
+		{
+			typeData.push_back(static_cast<std::uint8_t>(tt));
+		}
+		typeHashes.push_back(HashBytes(typeData.data(), typeData.size()));
+	}
+
+	//Offsets are collected in a separate forward scan first, because references are
+	//hashed by the distance between node ordinals, which may point forward.
+	for (std::uint32_t offset = 0; offset < nodeLength; )
+	{
+		if (!ValidateNodeOffset(data, offset))
+		{
+			throw ReaderException("Invalid node data");
+		}
+		ret._offsets.push_back(offset);
+		auto type = GetNodeType(data, offset);
+		offset += type->GetTotalLen();
+		if (type->HasChildren())
+		{
+			offset += data->NodeWidth;
+		}
+	}
+	ret._hashes.resize(ret._offsets.size());
+
+	auto readStrHash = [&](std::uint32_t* pPos)
+	{
+		auto index = ReadNumberU(content, pPos, data->StrWidth);
+		if (index >= strHashes.size())
+		{
+			throw ReaderException("Invalid string index");
+		}
+		return strHashes[index];
+	};
+	auto readRelativeNode = [&](std::uint32_t* pPos, std::uint32_t ordinal)
+	{
+		auto target = ReadNumberU(content, pPos, data->NodeWidth);
+		auto targetOrdinal = FindOrdinal(ret._offsets, target);
+		return static_cast<std::uint64_t>(static_cast<std::int64_t>(targetOrdinal) - ordinal);
+	};
+
+	struct Frame
+	{
+		std::uint32_t Ordinal;
+		std::uint32_t End;
+	};
+	std::vector<Frame> stack;
+	std::vector<std::vector<std::uint64_t>> words;
+
+	auto popFrame = [&]()
+	{
+		auto depth = stack.size() - 1;
+		auto& w = words[depth];
+		auto hash = HashBytes(w.data(), w.size() * sizeof(std::uint64_t));
+		ret._hashes[stack.back().Ordinal] = hash;
+		stack.pop_back();
+		if (depth > 0)
+		{
+			AppendHash(words[depth - 1], hash);
+		}
+	};
+
+	for (std::uint32_t ordinal = 0; ordinal < ret._offsets.size(); ++ordinal)
+	{
+		auto offset = ret._offsets[ordinal];
+		while (!stack.empty() && stack.back().End <= offset)
+		{
+			popFrame();
+		}
+
+		auto type = GetNodeType(data, offset);
+		auto end = GetNextNode(data, offset);
+		if (end > nodeLength)
+		{
+			throw ReaderException("Invalid node data");
+		}
+
+		stack.push_back({ ordinal, end });
+		if (words.size() < stack.size())
+		{
+			words.emplace_back();
+		}
+		auto& w = words[stack.size() - 1];
+		w.clear();
+		AppendHash(w, typeHashes[type - data->TypeList.data()]);
+
+		std::uint32_t pos = data->NodeRange.Start + offset + data->TypeWidth;
+		for (std::uint32_t i = 0; i < type->GetGenericArgCount(); ++i)
+		{
+			AppendHash(w, readStrHash(&pos));
+		}
+		for (auto tt : type->GetArgumentTypes())
+		{
+			switch (tt)
+			{
+			case NodeArgumentType::STR:
+				AppendHash(w, readStrHash(&pos));
+				break;
+			case NodeArgumentType::DAT:
+			{
+				auto begin = ReadNumberU(content, &pos, data->DataWidth);
+				auto dataEnd = ReadNumberU(content, &pos, data->DataWidth);
+				if (dataEnd < begin || dataEnd > data->DataRange.GetLength())
+				{
+					throw ReaderException("Invalid data offset");
+				}
+				AppendHash(w, HashBytes(GetDataBytes(data, begin, dataEnd, dataBuffer), dataEnd - begin));
+				break;
+			}
+			case NodeArgumentType::REF:
+				w.push_back(readRelativeNode(&pos, ordinal));
+				break;
+			case NodeArgumentType::REFFIELD:
+				w.push_back(readRelativeNode(&pos, ordinal));
+				AppendHash(w, readStrHash(&pos));
+				break;
+			default:
+				w.push_back(ReadNumberU(content, &pos, data->ArgumentWidth[(int)tt]));
+				break;
+			}
+		}
+	}
+	while (!stack.empty())
+	{
+		popFrame();
+	}
+
+	return ret;
+}
+
+bool NodeHashTable::TryGetHash(std::uint32_t offset, NodeHash* result) const
+{
+	auto it = std::lower_bound(_offsets.begin(), _offsets.end(), offset);
+	if (it == _offsets.end() || *it != offset)
+	{
+		return false;
+	}
+	*result = _hashes[it - _offsets.begin()];
+	return true;
+}
+
+NodeHash NodeHashTable::GetHash(const Node& node) const
+{
+	NodeHash ret;
+	if (node.GetDocumentData() != _document || !TryGetHash(node.GetOffset(), &ret))
+	{
+		throw ReaderException("Invalid node offset");
+	}
+	return ret;
+}
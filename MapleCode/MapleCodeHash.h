@@ -0,0 +1,49 @@
+#pragma once
+#include "MapleCodeReader.h"
+
+namespace MapleCode::Reader
+{
+	struct NodeHash
+	{
+		std::uint64_t Low = 0, High = 0;
+
+		bool operator==(const NodeHash& other) const
+		{
+			return Low == other.Low && High == other.High;
+		}
+
+		bool operator!=(const NodeHash& other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	NodeHash HashBytes(const void* data, std::size_t length, std::uint64_t seed = 0);
+
+	//Content hash of every subtree in a document. Hashes only depend on the content (type
+	//definitions, string values, data payloads, relative reference targets and children),
+	//so equal subtrees from different documents have equal hashes.
+	class NodeHashTable
+	{
+	private:
+		DocumentData* _document = nullptr;
+		std::pmr::vector<std::uint32_t> _offsets;
+		std::pmr::vector<NodeHash> _hashes;
+
+		explicit NodeHashTable(std::pmr::memory_resource* resource)
+			: _offsets(resource), _hashes(resource)
+		{
+		}
+
+	public:
+		NodeHashTable() = default;
+
+		//The tables are allocated from the memory resource of the document.
+		static NodeHashTable Compute(Document* doc);
+
+		std::size_t GetCount() const { return _offsets.size(); }
+
+		bool TryGetHash(std::uint32_t offset, NodeHash* result) const;
+		NodeHash GetHash(const Node& node) const;
+	};
+}
@@ -0,0 +1,461 @@
+#include "MapleCodeIndex.h"
+#include "MapleCodeInternal.h"
+#include "MapleCodeCompression.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace MapleCode::Reader;
+using namespace MapleCode::Reader::Internal;
+
+namespace
+{
+	const std::uint32_t SidecarMagic = 0x5849434D; //"MCIX"
+	const std::uint32_t SidecarVersion = 3;
+	const std::uint32_t FlagValidated = 1;
+	const std::uint32_t NoNode = 0xFFFFFFFF;
+
+	struct SidecarHeader
+	{
+		std::uint32_t Magic, Version;
+		std::uint64_t ContentHashLow, ContentHashHigh;
+		std::uint32_t ContentLength, NodeCount, TypeCount, ReferenceCount, Flags, Reserved;
+	};
+	static_assert(sizeof(SidecarHeader) == 48, "Unexpected sidecar header layout");
+
+	std::uint64_t GetRequiredLength(std::uint64_t nodeCount, std::uint64_t typeCount, std::uint64_t referenceCount)
+	{
+		return sizeof(SidecarHeader) + 4 * (nodeCount * 4 + typeCount + 1 + 1 + referenceCount);
+	}
+
+	void AppendArray(std::pmr::vector<std::uint8_t>& output, const std::vector<std::uint32_t>& data)
+	{
+		if (data.empty())
+		{
+			return;
+		}
+		auto pos = output.size();
+		output.resize(pos + data.size() * 4);
+		std::memcpy(output.data() + pos, data.data(), data.size() * 4);
+	}
+
+	//Read-only mapping of a whole file. Returns null if the file cannot be mapped.
+	std::shared_ptr<const std::uint8_t> MapFile(const std::string& path, std::size_t* pLength)
+	{
+#ifdef _WIN32
+		auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return nullptr;
+		}
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || static_cast<std::uint64_t>(size.QuadPart) > SIZE_MAX)
+		{
+			CloseHandle(file);
+			return nullptr;
+		}
+		auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (mapping == nullptr)
+		{
+			return nullptr;
+		}
+		auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (view == nullptr)
+		{
+			return nullptr;
+		}
+		*pLength = static_cast<std::size_t>(size.QuadPart);
+		return std::shared_ptr<const std::uint8_t>(static_cast<const std::uint8_t*>(view),
+			[](const std::uint8_t* p) { UnmapViewOfFile(p); });
+#else
+		auto fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return nullptr;
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size <= 0 || static_cast<std::uint64_t>(info.st_size) > SIZE_MAX)
+		{
+			close(fd);
+			return nullptr;
+		}
+		auto length = static_cast<std::size_t>(info.st_size);
+		auto view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (view == MAP_FAILED)
+		{
+			return nullptr;
+		}
+		*pLength = length;
+		return std::shared_ptr<const std::uint8_t>(static_cast<const std::uint8_t*>(view),
+			[length](const std::uint8_t* p) { munmap(const_cast<std::uint8_t*>(p), length); });
+#endif
+	}
+
+	//Write the file next to its destination and rename it into place, so readers never see a
+	//partially written sidecar. Returns false and removes the temporary file if either step fails.
+	bool ReplaceFile(const std::string& path, const std::uint8_t* data, std::size_t length)
+	{
+		auto tempPath = path + "." + std::to_string(std::random_device()()) + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(data), length);
+			file.close();
+			if (!file)
+			{
+				std::error_code ec;
+				std::filesystem::remove(tempPath, ec);
+				return false;
+			}
+		}
+		std::error_code ec;
+		std::filesystem::rename(tempPath, path, ec);
+		if (ec)
+		{
+			std::filesystem::remove(tempPath, ec);
+			return false;
+		}
+		return true;
+	}
+}
+
+NodeHash DocumentIndex::HashDocument(Document* doc)
+{
+	auto data = doc->GetDocumentData();
+	std::uint32_t layout[] = {
+		static_cast<std::uint32_t>(data->StrWidth), static_cast<std::uint32_t>(data->TypeWidth),
+		static_cast<std::uint32_t>(data->NodeWidth), static_cast<std::uint32_t>(data->DataWidth),
+		data->StrRange.End, data->TypeRange.End, data->NodeRange.End, data->DataRange.End,
+		static_cast<std::uint32_t>(data->TypeList.size()),
+	};
+	auto seed = HashBytes(layout, sizeof(layout));
+	//A compressed payload directly follows the node section in Content.
+	auto contentLength = data->CompressedData ?
+		data->NodeRange.End + data->CompressedData->GetPayloadLength() : data->DataRange.End;
+	return HashBytes(data->Content, contentLength, seed.Low ^ seed.High);
+}
+
+DocumentIndex DocumentIndex::Build(Document* doc)
+{
+	return Build(doc, HashDocument(doc));
+}
+
+DocumentIndex DocumentIndex::Build(Document* doc, const NodeHash& contentHash)
+{
+	auto data = doc->GetDocumentData();
+	auto content = data->Content;
+	auto nodeLength = data->NodeRange.GetLength();
+	auto typeCount = static_cast<std::uint32_t>(data->TypeList.size());
+	bool validated = true;
+
+	std::vector<std::uint32_t> offsets, parents, nodeTypes;
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> rawReferences;
+
+	struct Frame
+	{
+		std::uint32_t Ordinal;
+		std::uint32_t End;
+	};
+	std::vector<Frame> stack;
+
+	auto stringCount = data->GetStringCount();
+	auto checkString = [&](std::uint32_t* pPos)
+	{
+		if (ReadNumberU(content, pPos, data->StrWidth) >= stringCount)
+		{
+			validated = false;
+		}
+	};
+
+	for (std::uint32_t offset = 0; offset < nodeLength; )
+	{
+		while (!stack.empty() && offset >= stack.back().End)
+		{
+			stack.pop_back();
+		}
+		if (!ValidateNodeOffset(data, offset))
+		{
+			throw ReaderException("Invalid node data");
+		}
+		auto ordinal = static_cast<std::uint32_t>(offsets.size());
+		auto type = GetNodeType(data, offset);
+		offsets.push_back(offset);
+		parents.push_back(stack.empty() ? NoNode : stack.back().Ordinal);
+		nodeTypes.push_back(static_cast<std::uint32_t>(type - data->TypeList.data()));
+
+		std::uint32_t pos = data->NodeRange.Start + offset + data->TypeWidth;
+		for (std::uint32_t i = 0; i < type->GetGenericArgCount(); ++i)
+		{
+			checkString(&pos);
+		}
+		for (auto tt : type->GetArgumentTypes())
+		{
+			switch (tt)
+			{
+			case NodeArgumentType::STR:
+				checkString(&pos);
+				break;
+			case NodeArgumentType::DAT:
+			{
+				auto begin = ReadNumberU(content, &pos, data->DataWidth);
+				auto end = ReadNumberU(content, &pos, data->DataWidth);
+				if (end < begin || end > data->DataRange.GetLength())
+				{
+					validated = false;
+				}
+				break;
+			}
+			case NodeArgumentType::REF:
+				rawReferences.emplace_back(ReadNumberU(content, &pos, data->NodeWidth), ordinal);
+				break;
+			case NodeArgumentType::REFFIELD:
+				rawReferences.emplace_back(ReadNumberU(content, &pos, data->NodeWidth), ordinal);
+				checkString(&pos);
+				break;
+			default:
+				pos += data->ArgumentWidth[(int)tt];
+				break;
+			}
+		}
+
+		if (type->HasChildren())
+		{
+			auto end = GetNextNode(data, offset);
+			if (end > (stack.empty() ? nodeLength : stack.back().End))
+			{
+				throw ReaderException("Invalid node hierarchy");
+			}
+			stack.push_back({ ordinal, end });
+			offset += type->GetTotalLen() + data->NodeWidth;
+		}
+		else
+		{
+			offset += type->GetTotalLen();
+		}
+	}
+
+	auto nodeCount = static_cast<std::uint32_t>(offsets.size());
+
+	std::vector<std::uint32_t> typeStart(typeCount + 1), typeNodes(nodeCount);
+	for (auto t : nodeTypes)
+	{
+		typeStart[t + 1] += 1;
+	}
+	for (std::uint32_t t = 0; t < typeCount; ++t)
+	{
+		typeStart[t + 1] += typeStart[t];
+	}
+	{
+		auto next = typeStart;
+		for (std::uint32_t i = 0; i < nodeCount; ++i)
+		{
+			typeNodes[next[nodeTypes[i]]++] = i;
+		}
+	}
+
+	std::vector<std::uint32_t> referenceTargets;
+	std::vector<std::uint32_t> referenceStart(nodeCount + 1);
+	for (auto& reference : rawReferences)
+	{
+		auto it = std::lower_bound(offsets.begin(), offsets.end(), reference.first);
+		if (it == offsets.end() || *it != reference.first)
+		{
+			validated = false;
+			referenceTargets.push_back(NoNode);
+			continue;
+		}
+		auto target = static_cast<std::uint32_t>(it - offsets.begin());
+		referenceTargets.push_back(target);
+		referenceStart[target + 1] += 1;
+	}
+	for (std::uint32_t i = 0; i < nodeCount; ++i)
+	{
+		referenceStart[i + 1] += referenceStart[i];
+	}
+	std::vector<std::uint32_t> references(referenceStart[nodeCount]);
+	{
+		auto next = referenceStart;
+		for (std::size_t i = 0; i < rawReferences.size(); ++i)
+		{
+			if (referenceTargets[i] != NoNode)
+			{
+				references[next[referenceTargets[i]]++] = rawReferences[i].second;
+			}
+		}
+	}
+
+	SidecarHeader header = {};
+	header.Magic = SidecarMagic;
+	header.Version = SidecarVersion;
+	header.ContentHashLow = contentHash.Low;
+	header.ContentHashHigh = contentHash.High;
+	header.ContentLength = data->DataRange.End;
+	header.NodeCount = nodeCount;
+	header.TypeCount = typeCount;
+	header.ReferenceCount = static_cast<std::uint32_t>(references.size());
+	header.Flags = validated ? FlagValidated : 0;
+
+	//The allocator is passed on to the vector, so its elements are in the same resource.
+	auto storage = std::allocate_shared<std::pmr::vector<std::uint8_t>>(
+		std::pmr::polymorphic_allocator<std::pmr::vector<std::uint8_t>>(data->Resource), sizeof(SidecarHeader));
+	std::memcpy(storage->data(), &header, sizeof(SidecarHeader));
+	AppendArray(*storage, offsets);
+	AppendArray(*storage, parents);
+	AppendArray(*storage, typeStart);
+	AppendArray(*storage, typeNodes);
+	AppendArray(*storage, referenceStart);
+	AppendArray(*storage, references);
+
+	DocumentIndex ret;
+	ret._storage = std::shared_ptr<const std::uint8_t>(storage, storage->data());
+	ret._storageLength = storage->size();
+	ret.AttachStorage(doc, ret._storage.get(), ret._storageLength, contentHash);
+	return ret;
+}
+
+bool DocumentIndex::AttachStorage(Document* document, const void* data, std::size_t length,
+	const NodeHash& contentHash)
+{
+	if (length < sizeof(SidecarHeader) || reinterpret_cast<std::uintptr_t>(data) % 4 != 0)
+	{
+		return false;
+	}
+	auto doc = document->GetDocumentData();
+	SidecarHeader header;
+	std::memcpy(&header, data, sizeof(SidecarHeader));
+	if (header.Magic != SidecarMagic || header.Version != SidecarVersion ||
+		header.ContentLength != doc->DataRange.End || header.TypeCount != doc->TypeList.size() ||
+		GetRequiredLength(header.NodeCount, header.TypeCount, header.ReferenceCount) > length)
+	{
+		return false;
+	}
+	if (header.ContentHashLow != contentHash.Low || header.ContentHashHigh != contentHash.High)
+	{
+		return false;
+	}
+
+	auto arrays = reinterpret_cast<const std::uint32_t*>(static_cast<const std::uint8_t*>(data) + sizeof(SidecarHeader));
+	_document = doc;
+	_nodeCount = header.NodeCount;
+	_typeCount = header.TypeCount;
+	_referenceCount = header.ReferenceCount;
+	_validated = (header.Flags & FlagValidated) != 0;
+	_offsets = arrays;
+	_parents = _offsets + _nodeCount;
+	_typeStart = _parents + _nodeCount;
+	_typeNodes = _typeStart + _typeCount + 1;
+	_referenceStart = _typeNodes + _nodeCount;
+	_references = _referenceStart + _nodeCount + 1;
+	return true;
+}
+
+bool DocumentIndex::TryAttach(Document* doc, const void* sidecar, std::size_t length, DocumentIndex* result)
+{
+	DocumentIndex ret;
+	if (!ret.AttachStorage(doc, sidecar, length, HashDocument(doc)))
+	{
+		return false;
+	}
+	*result = std::move(ret);
+	return true;
+}
+
+DocumentIndex DocumentIndex::LoadOrBuild(Document* doc, const std::string& path)
+{
+	auto contentHash = HashDocument(doc);
+	{
+		DocumentIndex ret;
+		ret._storage = MapFile(path, &ret._storageLength);
+		if (ret._storage && ret.AttachStorage(doc, ret._storage.get(), ret._storageLength, contentHash))
+		{
+			return ret;
+		}
+		//The stale mapping is released here, before the file is replaced.
+	}
+
+	//The index is valid even if the sidecar cannot be written, for example on Windows while
+	//another index still maps the old file, so the next call builds it again.
+	auto ret = Build(doc, contentHash);
+	ReplaceFile(path, ret._storage.get(), ret._storageLength);
+	return ret;
+}
+
+std::uint32_t DocumentIndex::GetOrdinal(const Node& node) const
+{
+	auto end = _offsets + _nodeCount;
+	auto it = std::lower_bound(_offsets, end, node.GetOffset());
+	if (node.GetDocumentData() != _document || it == end || *it != node.GetOffset())
+	{
+		throw ReaderException("Invalid node offset");
+	}
+	return static_cast<std::uint32_t>(it - _offsets);
+}
+
+Node DocumentIndex::GetParent(const Node& node) const
+{
+	auto parent = _parents[GetOrdinal(node)];
+	if (parent == NoNode)
+	{
+		return { nullptr, 0 };
+	}
+	if (parent >= _nodeCount)
+	{
+		throw ReaderException("Invalid index data");
+	}
+	return { _document, _offsets[parent] };
+}
+
+void DocumentIndex::GetNodesOfType(std::uint32_t typeIndex, std::vector<Node>& results) const
+{
+	results.clear();
+	if (typeIndex >= _typeCount)
+	{
+		throw ReaderException("Invalid node type");
+	}
+	auto begin = _typeStart[typeIndex], end = _typeStart[typeIndex + 1];
+	if (begin > end || end > _nodeCount)
+	{
+		throw ReaderException("Invalid index data");
+	}
+	for (auto i = begin; i < end; ++i)
+	{
+		if (_typeNodes[i] >= _nodeCount)
+		{
+			throw ReaderException("Invalid index data");
+		}
+		results.push_back({ _document, _offsets[_typeNodes[i]] });
+	}
+}
+
+void DocumentIndex::GetReferencesTo(const Node& node, std::vector<Node>& results) const
+{
+	results.clear();
+	auto ordinal = GetOrdinal(node);
+	auto begin = _referenceStart[ordinal], end = _referenceStart[ordinal + 1];
+	if (begin > end || end > _referenceCount)
+	{
+		throw ReaderException("Invalid index data");
+	}
+	for (auto i = begin; i < end; ++i)
+	{
+		if (_references[i] >= _nodeCount)
+		{
+			throw ReaderException("Invalid index data");
+		}
+		results.push_back({ _document, _offsets[_references[i]] });
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "MapleCodeReader.h"
+#include "MapleCodeHash.h"
+
+namespace MapleCode::Reader
+{
+	//Derived navigation indexes of a document (parent links, nodes per type, reference
+	//back-links and validation status), stored in a sidecar layout that can be attached
+	//directly from a file or memory mapping without parsing.
+	//
+	//Sidecar layout (little-endian, 4-byte aligned):
+	//  header: magic, version, content hash (128 bit), content length, node count, type count,
+	//          reference count, flags, reserved
+	//  u32 NodeOffsets[node count]        node offsets in document order
+	//  u32 Parents[node count]            parent ordinal, or 0xFFFFFFFF for top-level nodes
+	//  u32 TypeStart[type count + 1]      ranges in TypeNodes for each type
+	//  u32 TypeNodes[node count]          node ordinals grouped by type
+	//  u32 ReferenceStart[node count + 1] ranges in References for each target node
+	//  u32 References[reference count]    ordinals of nodes referring to the target node
+	class DocumentIndex
+	{
+	private:
+		DocumentData* _document = nullptr;
+		std::shared_ptr<const std::uint8_t> _storage;
+		std::size_t _storageLength = 0;
+		std::uint32_t _nodeCount = 0, _typeCount = 0, _referenceCount = 0;
+		bool _validated = false;
+		const std::uint32_t* _offsets = nullptr;
+		const std::uint32_t* _parents = nullptr;
+		const std::uint32_t* _typeStart = nullptr;
+		const std::uint32_t* _typeNodes = nullptr;
+		const std::uint32_t* _referenceStart = nullptr;
+		const std::uint32_t* _references = nullptr;
+
+		static DocumentIndex Build(Document* doc, const NodeHash& contentHash);
+		bool AttachStorage(Document* doc, const void* data, std::size_t length, const NodeHash& contentHash);
+		std::uint32_t GetOrdinal(const Node& node) const;
+
+	public:
+		DocumentIndex() = default;
+		DocumentIndex(const DocumentIndex&) = delete;
+		DocumentIndex(DocumentIndex&&) = default;
+		DocumentIndex& operator=(const DocumentIndex&) = delete;
+		DocumentIndex& operator=(DocumentIndex&&) = default;
+
+		//Hash of the whole document content, which is checked on every attach. Proportional to
+		//the document size.
+		static NodeHash HashDocument(Document* doc);
+
+		//The sidecar is allocated from the document's memory resource.
+		static DocumentIndex Build(Document* doc);
+
+		//Attach a sidecar without copying it. The sidecar memory must outlive the index.
+		//Returns false if the sidecar does not belong to this document.
+		static bool TryAttach(Document* doc, const void* sidecar, std::size_t length, DocumentIndex* result);
+
+		//Map the sidecar file at the given path, or rebuild the index and replace the file
+		//if it is missing or does not match the document. Replacing the file is best-effort:
+		//if it fails, the rebuilt index is returned from memory.
+		static DocumentIndex LoadOrBuild(Document* doc, const std::string& path);
+
+		//Sidecar bytes of an index created by Build or LoadOrBuild.
+		const std::uint8_t* GetSidecarData() const { return _storage.get(); }
+		std::size_t GetSidecarLength() const { return _storageLength; }
+
+		bool IsValidated() const { return _validated; }
+		std::uint32_t GetNodeCount() const { return _nodeCount; }
+
+		Node GetParent(const Node& node) const;
+		void GetNodesOfType(std::uint32_t typeIndex, std::vector<Node>& results) const;
+		void GetReferencesTo(const Node& node, std::vector<Node>& results) const;
+	};
+}
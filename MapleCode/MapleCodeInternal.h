@@ -0,0 +1,132 @@
+#pragma once
+#include "MapleCodeReader.h"
+#include <cstring>
+
+namespace MapleCode::Reader::Internal
+{
+	static const std::uint32_t SizeModeToSize[] = { 0, 1, 2, 4 };
+
+	//A SizeMode byte of 0 (never valid as a SizeMode) introduces an extended header:
+	//0x00, flags, SizeMode, followed by the usual section lengths.
+	static const std::uint8_t ExtendedHeaderMarker = 0;
+	static const std::uint8_t DocumentFlagCompressedData = 1;
+
+	inline std::uint32_t ReadNumberU(const void* data, std::uint32_t* pPos, int size)
+	{
+		const char* data8 = static_cast<const char*>(data);
+		std::uint32_t ret = 0;
+		std::memcpy(&ret, data8 + *pPos, size);
+		*pPos += size;
+		return ret;
+	}
+
+	inline std::uint8_t WidthToSizeMode(std::uint32_t width)
+	{
+		return width == 1 ? 1 : width == 2 ? 2 : 3;
+	}
+
+	template <typename Buffer>
+	inline void AppendNumber(Buffer& buffer, std::uint32_t val, std::uint32_t width)
+	{
+		auto pos = buffer.size();
+		buffer.resize(pos + width);
+		std::memcpy(buffer.data() + pos, &val, width);
+	}
+
+	inline bool FitsWidth(std::uint64_t value, std::uint32_t width)
+	{
+		return value <= (std::uint64_t{ 1 } << (width * 8)) - 1;
+	}
+
+	template <typename T, typename RET = std::int32_t>
+	inline RET ConvertNumber(std::uint32_t val)
+	{
+		T ret = {};
+		std::memcpy(&ret, &val, sizeof(T));
+		return static_cast<RET>(ret);
+	}
+
+	inline NodeType* GetNodeType(DocumentData* doc, std::uint32_t offset)
+	{
+		std::uint32_t pos = doc->NodeRange.Start + offset;
+		auto typeIndex = ReadNumberU(doc->Content, &pos, doc->TypeWidth);
+		if (typeIndex >= doc->TypeList.size())
+		{
+			throw ReaderException("Invalid node type");
+		}
+		return &doc->TypeList[typeIndex];
+	}
+
+	inline std::uint32_t GetNextNode(DocumentData* doc, std::uint32_t offset)
+	{
+		auto type = GetNodeType(doc, offset);
+		if (type->HasChildren())
+		{
+			std::uint32_t pos = doc->NodeRange.Start + offset + type->GetTotalLen();
+			auto childrenLen = ReadNumberU(doc->Content, &pos, doc->NodeWidth);
+			return offset + type->GetTotalLen() + doc->NodeWidth + childrenLen;
+		}
+		return offset + type->GetTotalLen();
+	}
+
+	inline bool ValidateNodeOffset(DocumentData* doc, std::uint32_t offset)
+	{
+		auto type = GetNodeType(doc, offset);
+		auto nodeEnd = offset + type->GetTotalLen();
+		if (type->HasChildren())
+		{
+			nodeEnd += doc->NodeWidth;
+		}
+		return nodeEnd <= doc->NodeRange.GetLength();
+	}
+
+	//Whether a node starts at offset, found by skipping sibling subtrees and descending only
+	//into the node that contains offset.
+	inline bool IsNodeStart(DocumentData* doc, std::uint32_t offset)
+	{
+		std::uint32_t pos = 0, end = doc->NodeRange.GetLength();
+		while (pos < end && pos <= offset)
+		{
+			if (pos == offset)
+			{
+				return ValidateNodeOffset(doc, pos);
+			}
+			if (!ValidateNodeOffset(doc, pos))
+			{
+				return false;
+			}
+			auto next = GetNextNode(doc, pos);
+			if (next <= pos)
+			{
+				return false;
+			}
+			if (next <= offset)
+			{
+				pos = next;
+				continue;
+			}
+			auto type = GetNodeType(doc, pos);
+			if (!type->HasChildren())
+			{
+				return false;
+			}
+			end = next;
+			pos += type->GetTotalLen() + doc->NodeWidth;
+		}
+		return false;
+	}
+
+	//Pointer to bytes [begin, end) of the data section, copied into buffer if the section is
+	//compressed. The range must have been validated by the caller.
+	inline const std::uint8_t* GetDataBytes(DocumentData* doc, std::uint32_t begin, std::uint32_t end,
+		std::vector<std::uint8_t>& buffer)
+	{
+		if (!doc->CompressedData)
+		{
+			return doc->Content + doc->DataRange.Start + begin;
+		}
+		buffer.resize(end - begin);
+		doc->CopyData(begin, end, buffer.data());
+		return buffer.data();
+	}
+}
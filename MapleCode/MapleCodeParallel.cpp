@@ -0,0 +1,380 @@
+#include "MapleCodeParallel.h"
+#include "MapleCodeInternal.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <system_error>
+
+using namespace MapleCode::Reader;
+using namespace MapleCode::Reader::Internal;
+
+namespace
+{
+	//Pool whose job the current thread is running, used to run nested jobs inline.
+	thread_local const WorkerPool* CurrentPool = nullptr;
+
+	struct Task
+	{
+		std::uint32_t Begin, End;
+	};
+
+	class WorkStealingScheduler
+	{
+	private:
+		struct WorkerQueue
+		{
+			std::mutex Lock;
+			std::deque<Task> Tasks;
+		};
+
+		DocumentData* _document;
+		const std::function<void(const Node&)>& _fn;
+		std::uint32_t _grainSize;
+		bool _recursive;
+
+		std::vector<std::unique_ptr<WorkerQueue>> _queues;
+		//Tasks pushed and not yet finished, and tasks waiting in a queue.
+		std::atomic<std::size_t> _pending{ 0 }, _queued{ 0 };
+		std::mutex _idleLock;
+		std::condition_variable _idle;
+		std::atomic<bool> _failed{ false };
+		std::mutex _errorLock;
+		std::exception_ptr _error;
+
+	public:
+		WorkStealingScheduler(DocumentData* doc, const std::function<void(const Node&)>& fn,
+			const ParallelOptions& options, std::size_t workerCount)
+			: _document(doc), _fn(fn), _grainSize(options.GrainSize == 0 ? 1 : options.GrainSize),
+			_recursive(options.Recursive)
+		{
+			for (std::size_t i = 0; i < workerCount; ++i)
+			{
+				_queues.push_back(std::make_unique<WorkerQueue>());
+			}
+		}
+
+		void Push(std::size_t worker, Task task)
+		{
+			++_pending;
+			{
+				auto& queue = *_queues[worker];
+				std::lock_guard<std::mutex> lock(queue.Lock);
+				queue.Tasks.push_back(task);
+			}
+			++_queued;
+			//Taking the lock orders the notification after any waiter's predicate check.
+			{
+				std::lock_guard<std::mutex> lock(_idleLock);
+			}
+			_idle.notify_one();
+		}
+
+		void Run(std::size_t worker)
+		{
+			Task task;
+			while (true)
+			{
+				if (!TryPop(worker, &task) && !TrySteal(worker, &task))
+				{
+					std::unique_lock<std::mutex> lock(_idleLock);
+					_idle.wait(lock, [this]() { return _pending.load() == 0 || _queued.load() != 0; });
+					if (_pending.load() == 0)
+					{
+						return;
+					}
+					continue;
+				}
+				if (!_failed.load())
+				{
+					try
+					{
+						Process(worker, task);
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lock(_errorLock);
+						if (!_error)
+						{
+							_error = std::current_exception();
+						}
+						_failed = true;
+					}
+				}
+				if (--_pending == 0)
+				{
+					std::lock_guard<std::mutex> lock(_idleLock);
+					_idle.notify_all();
+				}
+			}
+		}
+
+		void RethrowError()
+		{
+			if (_error)
+			{
+				std::rethrow_exception(_error);
+			}
+		}
+
+	private:
+		bool TryPop(std::size_t worker, Task* result)
+		{
+			auto& queue = *_queues[worker];
+			std::lock_guard<std::mutex> lock(queue.Lock);
+			if (queue.Tasks.empty())
+			{
+				return false;
+			}
+			*result = queue.Tasks.back();
+			queue.Tasks.pop_back();
+			--_queued;
+			return true;
+		}
+
+		bool TrySteal(std::size_t worker, Task* result)
+		{
+			for (std::size_t i = 1; i < _queues.size(); ++i)
+			{
+				auto& queue = *_queues[(worker + i) % _queues.size()];
+				std::lock_guard<std::mutex> lock(queue.Lock);
+				if (!queue.Tasks.empty())
+				{
+					//Steal the oldest task, which is usually the largest one.
+					*result = queue.Tasks.front();
+					queue.Tasks.pop_front();
+					--_queued;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		std::uint32_t GetNodeEnd(std::uint32_t offset, std::uint32_t end)
+		{
+			if (!ValidateNodeOffset(_document, offset))
+			{
+				throw ReaderException("Invalid node data");
+			}
+			auto next = GetNextNode(_document, offset);
+			if (next <= offset || next > end)
+			{
+				throw ReaderException("Invalid node data");
+			}
+			return next;
+		}
+
+		void ProcessSequential(std::uint32_t begin, std::uint32_t end)
+		{
+			for (auto offset = begin; offset < end; )
+			{
+				if (!_recursive)
+				{
+					auto next = GetNodeEnd(offset, end);
+					_fn({ _document, offset });
+					offset = next;
+					continue;
+				}
+				//Children directly follow their parent, so a flat scan visits all descendants.
+				if (!ValidateNodeOffset(_document, offset))
+				{
+					throw ReaderException("Invalid node data");
+				}
+				auto type = GetNodeType(_document, offset);
+				auto next = offset + type->GetTotalLen() + (type->HasChildren() ? _document->NodeWidth : 0);
+				if (next > end)
+				{
+					throw ReaderException("Invalid node data");
+				}
+				_fn({ _document, offset });
+				offset = next;
+			}
+		}
+
+		void Process(std::size_t worker, Task task)
+		{
+			if (task.End - task.Begin <= _grainSize)
+			{
+				ProcessSequential(task.Begin, task.End);
+				return;
+			}
+
+			auto chunkStart = task.Begin;
+			for (auto offset = task.Begin; offset < task.End; )
+			{
+				auto next = GetNodeEnd(offset, task.End);
+				if (_recursive && next - offset > _grainSize)
+				{
+					if (chunkStart < offset)
+					{
+						Push(worker, { chunkStart, offset });
+					}
+					Node node = { _document, offset };
+					_fn(node);
+					auto children = node.GetChildren();
+					if (children.GetBeginOffset() != children.GetEndOffset())
+					{
+						Push(worker, { children.GetBeginOffset(), children.GetEndOffset() });
+					}
+					chunkStart = next;
+				}
+				else if (next - chunkStart >= _grainSize && next < task.End)
+				{
+					Push(worker, { chunkStart, next });
+					chunkStart = next;
+				}
+				offset = next;
+			}
+			//The last chunk is never pushed, so every pushed range is smaller than the task.
+			ProcessSequential(chunkStart, task.End);
+		}
+	};
+}
+
+WorkerPool::WorkerPool(std::uint32_t threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+		threadCount = threadCount == 0 ? 1 : threadCount;
+	}
+	try
+	{
+		for (std::size_t i = 1; i < threadCount; ++i)
+		{
+			_threads.emplace_back([this, i]() { WorkerMain(i); });
+		}
+	}
+	catch (const std::system_error&)
+	{
+		//Continue with the threads that could be started.
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_stopping = true;
+	}
+	_wake.notify_all();
+	for (auto& thread : _threads)
+	{
+		thread.join();
+	}
+}
+
+WorkerPool& WorkerPool::GetDefault()
+{
+	//Never destroyed, so no worker is joined during static destruction.
+	static WorkerPool* pool = new WorkerPool();
+	return *pool;
+}
+
+void WorkerPool::WorkerMain(std::size_t worker)
+{
+	CurrentPool = this;
+	std::uint64_t generation = 0;
+	std::unique_lock<std::mutex> lock(_lock);
+	while (true)
+	{
+		_wake.wait(lock, [&]() { return _stopping || _generation != generation; });
+		if (_stopping)
+		{
+			return;
+		}
+		generation = _generation;
+		if (worker >= _jobWorkers)
+		{
+			continue;
+		}
+		auto job = _job;
+		lock.unlock();
+		std::exception_ptr error;
+		try
+		{
+			(*job)(worker);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+		lock.lock();
+		if (error && !_error)
+		{
+			_error = error;
+		}
+		if (--_running == 0)
+		{
+			_done.notify_one();
+		}
+	}
+}
+
+void WorkerPool::Run(const std::function<void(std::size_t)>& job, std::size_t workers)
+{
+	if (CurrentPool == this || workers <= 1 || _threads.empty())
+	{
+		job(0);
+		return;
+	}
+	std::lock_guard<std::mutex> jobLock(_jobLock);
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_job = &job;
+		_jobWorkers = std::min(workers, GetThreadCount());
+		_running = _jobWorkers - 1;
+		_error = nullptr;
+		++_generation;
+	}
+	_wake.notify_all();
+
+	std::exception_ptr error;
+	auto previousPool = CurrentPool;
+	CurrentPool = this;
+	try
+	{
+		job(0);
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+	CurrentPool = previousPool;
+
+	std::unique_lock<std::mutex> lock(_lock);
+	_done.wait(lock, [this]() { return _running == 0; });
+	_job = nullptr;
+	if (!error)
+	{
+		error = _error;
+	}
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+void MapleCode::Reader::ParallelForEach(WorkerPool& pool, NodeRange range, const std::function<void(const Node&)>& fn,
+	const ParallelOptions& options)
+{
+	if (range.GetBeginOffset() >= range.GetEndOffset())
+	{
+		return;
+	}
+	std::size_t workerCount = pool.GetThreadCount();
+	if (options.ThreadCount != 0)
+	{
+		workerCount = std::min<std::size_t>(workerCount, options.ThreadCount);
+	}
+
+	WorkStealingScheduler scheduler(range.GetDocumentData(), fn, options, workerCount);
+	scheduler.Push(0, { range.GetBeginOffset(), range.GetEndOffset() });
+	pool.Run([&scheduler](std::size_t worker) { scheduler.Run(worker); }, workerCount);
+	scheduler.RethrowError();
+}
+
+void MapleCode::Reader::ParallelForEach(NodeRange range, const std::function<void(const Node&)>& fn,
+	const ParallelOptions& options)
+{
+	ParallelForEach(WorkerPool::GetDefault(), range, fn, options);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "MapleCodeReader.h"
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace MapleCode::Reader
+{
+	struct ParallelOptions
+	{
+		//Maximum number of threads including the calling thread, limited by the size of the
+		//pool. 0 uses the whole pool.
+		std::uint32_t ThreadCount = 0;
+		//Ranges with at most this many bytes of node data are processed by one thread
+		//without further splitting.
+		std::uint32_t GrainSize = 16384;
+		//Also visit the descendants of the nodes in the range.
+		bool Recursive = true;
+	};
+
+	//Persistent worker threads for ParallelForEach. Workers sleep on a condition variable
+	//between jobs, and one job runs at a time. A job started from one of the pool's own
+	//threads runs inline on that thread.
+	class WorkerPool
+	{
+	private:
+		std::vector<std::thread> _threads;
+		std::mutex _jobLock;
+		std::mutex _lock;
+		std::condition_variable _wake, _done;
+		const std::function<void(std::size_t)>* _job = nullptr;
+		std::size_t _jobWorkers = 0, _running = 0;
+		std::uint64_t _generation = 0;
+		bool _stopping = false;
+		std::exception_ptr _error;
+
+		void WorkerMain(std::size_t worker);
+
+	public:
+		//Number of threads including the calling thread. 0 uses the hardware concurrency.
+		explicit WorkerPool(std::uint32_t threadCount = 0);
+		~WorkerPool();
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		//Shared pool sized to the hardware concurrency, created on first use.
+		static WorkerPool& GetDefault();
+
+		std::size_t GetThreadCount() const { return _threads.size() + 1; }
+
+		//Calls job(i) for i in [0, workers) concurrently, with job(0) on the calling thread,
+		//and waits for all calls to return. workers is limited to GetThreadCount().
+		void Run(const std::function<void(std::size_t)>& job, std::size_t workers);
+	};
+
+	//Calls fn for every node in the range (and, if Recursive, every descendant) from a
+	//pool of worker threads. The range is split at node boundaries and subtrees larger than
+	//the grain size are split into their child ranges, and idle workers steal pending ranges
+	//from busy ones. fn is called concurrently and in no particular order. If fn throws,
+	//remaining ranges are skipped and the first exception is rethrown after all workers exit.
+	void ParallelForEach(WorkerPool& pool, NodeRange range, const std::function<void(const Node&)>& fn,
+		const ParallelOptions& options = {});
+
+	//Same as above, using WorkerPool::GetDefault().
+	void ParallelForEach(NodeRange range, const std::function<void(const Node&)>& fn,
+		const ParallelOptions& options = {});
+}
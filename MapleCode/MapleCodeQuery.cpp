@@ -0,0 +1,416 @@
+#include "MapleCodeQuery.h"
+#include "MapleCodeInternal.h"
+#include <cctype>
+#include <cstdlib>
+#include <unordered_map>
+
+using namespace MapleCode::Reader;
+using namespace MapleCode::Reader::Internal;
+
+namespace
+{
+	enum class LiteralKind
+	{
+		String,
+		Integer,
+		Float,
+	};
+
+	struct Literal
+	{
+		LiteralKind Kind = LiteralKind::Integer;
+		std::string String;
+		std::int64_t Integer = 0;
+		float Float = 0;
+	};
+
+	struct ParsedStep
+	{
+		bool Descendant = false;
+		std::string Name;
+		bool HasGenerics = false;
+		std::vector<std::string> Generics;
+		std::vector<std::pair<std::uint32_t, Literal>> Predicates;
+	};
+
+	class QueryParser
+	{
+	private:
+		const std::string& _text;
+		std::size_t _pos = 0;
+
+	public:
+		QueryParser(const std::string& text) : _text(text) {}
+
+		std::vector<ParsedStep> Parse()
+		{
+			std::vector<ParsedStep> ret;
+			SkipSpaces();
+			while (_pos < _text.size())
+			{
+				ParsedStep step;
+				Expect('/');
+				step.Descendant = TryRead('/');
+				step.Name = ReadName();
+				if (TryRead('<'))
+				{
+					step.HasGenerics = true;
+					do
+					{
+						step.Generics.push_back(ReadName());
+					} while (TryRead(','));
+					Expect('>');
+				}
+				while (TryRead('['))
+				{
+					auto index = ReadLiteral();
+					if (index.Kind != LiteralKind::Integer || index.Integer < 0 || index.Integer > 255)
+					{
+						throw ReaderException("Invalid query syntax");
+					}
+					Expect('=');
+					step.Predicates.emplace_back(static_cast<std::uint32_t>(index.Integer), ReadLiteral());
+					Expect(']');
+				}
+				ret.push_back(std::move(step));
+				SkipSpaces();
+			}
+			if (ret.empty() || ret.size() > 64)
+			{
+				throw ReaderException("Invalid query syntax");
+			}
+			return ret;
+		}
+
+	private:
+		void SkipSpaces()
+		{
+			while (_pos < _text.size() && std::isspace(static_cast<unsigned char>(_text[_pos])))
+			{
+				++_pos;
+			}
+		}
+
+		bool TryRead(char c)
+		{
+			SkipSpaces();
+			if (_pos < _text.size() && _text[_pos] == c)
+			{
+				++_pos;
+				return true;
+			}
+			return false;
+		}
+
+		void Expect(char c)
+		{
+			if (!TryRead(c))
+			{
+				throw ReaderException("Invalid query syntax");
+			}
+		}
+
+		static bool IsNameChar(char c)
+		{
+			return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.';
+		}
+
+		std::string ReadName()
+		{
+			SkipSpaces();
+			if (TryRead('*'))
+			{
+				return "*";
+			}
+			auto start = _pos;
+			while (_pos < _text.size() && IsNameChar(_text[_pos]))
+			{
+				++_pos;
+			}
+			if (start == _pos)
+			{
+				throw ReaderException("Invalid query syntax");
+			}
+			return _text.substr(start, _pos - start);
+		}
+
+		Literal ReadLiteral()
+		{
+			SkipSpaces();
+			Literal ret;
+			if (TryRead('"'))
+			{
+				ret.Kind = LiteralKind::String;
+				while (true)
+				{
+					if (_pos >= _text.size())
+					{
+						throw ReaderException("Invalid query syntax");
+					}
+					char c = _text[_pos++];
+					if (c == '"')
+					{
+						break;
+					}
+					if (c == '\\' && _pos < _text.size())
+					{
+						c = _text[_pos++];
+					}
+					ret.String.push_back(c);
+				}
+				return ret;
+			}
+
+			auto start = _pos;
+			if (_pos < _text.size() && (_text[_pos] == '-' || _text[_pos] == '+'))
+			{
+				++_pos;
+			}
+			bool isFloat = false;
+			while (_pos < _text.size() && (std::isdigit(static_cast<unsigned char>(_text[_pos])) || _text[_pos] == '.'))
+			{
+				isFloat |= _text[_pos] == '.';
+				++_pos;
+			}
+			auto str = _text.substr(start, _pos - start);
+			char* end = nullptr;
+			if (isFloat)
+			{
+				ret.Kind = LiteralKind::Float;
+				ret.Float = std::strtof(str.c_str(), &end);
+			}
+			else
+			{
+				ret.Kind = LiteralKind::Integer;
+				ret.Integer = std::strtoll(str.c_str(), &end, 10);
+			}
+			if (str.empty() || end != str.c_str() + str.size())
+			{
+				throw ReaderException("Invalid query syntax");
+			}
+			return ret;
+		}
+	};
+
+	//Converts a literal to the encoded value of an argument slot. Returns false if the
+	//literal can never be equal to a value of that type.
+	bool EncodeLiteral(const Literal& literal, NodeArgumentType type,
+		const std::unordered_map<std::string, std::uint32_t>& strings, std::uint32_t* result)
+	{
+		std::int64_t min = 0, max = 0;
+		switch (type)
+		{
+		case NodeArgumentType::STR:
+		{
+			if (literal.Kind != LiteralKind::String) return false;
+			auto it = strings.find(literal.String);
+			if (it == strings.end()) return false;
+			*result = it->second;
+			return true;
+		}
+		case NodeArgumentType::F32:
+		{
+			if (literal.Kind == LiteralKind::String) return false;
+			float f = literal.Kind == LiteralKind::Float ? literal.Float : static_cast<float>(literal.Integer);
+			std::memcpy(result, &f, 4);
+			return true;
+		}
+		case NodeArgumentType::U8: max = UINT8_MAX; break;
+		case NodeArgumentType::U16: max = UINT16_MAX; break;
+		case NodeArgumentType::U32: max = UINT32_MAX; break;
+		case NodeArgumentType::S8: min = INT8_MIN; max = INT8_MAX; break;
+		case NodeArgumentType::S16: min = INT16_MIN; max = INT16_MAX; break;
+		case NodeArgumentType::S32: min = INT32_MIN; max = INT32_MAX; break;
+		default:
+			return false;
+		}
+		if (literal.Kind != LiteralKind::Integer || literal.Integer < min || literal.Integer > max)
+		{
+			return false;
+		}
+		auto width = (type == NodeArgumentType::U8 || type == NodeArgumentType::S8) ? 1 :
+			(type == NodeArgumentType::U16 || type == NodeArgumentType::S16) ? 2 : 4;
+		auto value = static_cast<std::uint32_t>(literal.Integer);
+		*result = width == 4 ? value : value & ((1u << (width * 8)) - 1);
+		return true;
+	}
+}
+
+NodeQuery NodeQuery::Compile(Document* doc, const std::string& query)
+{
+	auto parsed = QueryParser(query).Parse();
+	auto data = doc->GetDocumentData();
+
+	std::unordered_map<std::string, std::uint32_t> strings;
+	auto stringCount = data->GetStringCount();
+	for (std::uint32_t i = 0; i < stringCount; ++i)
+	{
+		strings.emplace(data->GetString(i), i);
+	}
+
+	NodeQuery ret(data);
+	for (auto& parsedStep : parsed)
+	{
+		Step step(data->Resource);
+		step.Descendant = parsedStep.Descendant;
+		bool any = false;
+		for (auto& type : data->TypeList)
+		{
+			TypeMatch match(data->Resource);
+			match.Matches = parsedStep.Name == "*" || parsedStep.Name == type.GetName();
+
+			auto genericCount = type.GetGenericArgCount();
+			if (match.Matches && parsedStep.HasGenerics)
+			{
+				match.Matches = parsedStep.Generics.size() == genericCount;
+				for (std::uint32_t i = 0; match.Matches && i < genericCount; ++i)
+				{
+					auto& g = parsedStep.Generics[i];
+					if (g == "*") continue;
+					auto it = strings.find(g);
+					if (it == strings.end())
+					{
+						match.Matches = false;
+						break;
+					}
+					match.Checks.push_back({ data->TypeWidth + data->StrWidth * i,
+						static_cast<std::uint32_t>(data->StrWidth), it->second });
+				}
+			}
+
+			auto& argTypes = type.GetArgumentTypes();
+			for (auto& predicate : parsedStep.Predicates)
+			{
+				if (!match.Matches) break;
+				auto index = predicate.first;
+				if (index >= argTypes.size())
+				{
+					match.Matches = false;
+					break;
+				}
+				std::uint32_t offset = data->TypeWidth + data->StrWidth * genericCount;
+				for (std::uint32_t i = 0; i < index; ++i)
+				{
+					offset += data->ArgumentWidth[(int)argTypes[i]];
+				}
+				std::uint32_t expected;
+				if (!EncodeLiteral(predicate.second, argTypes[index], strings, &expected))
+				{
+					match.Matches = false;
+					break;
+				}
+				match.Checks.push_back({ offset, data->ArgumentWidth[(int)argTypes[index]], expected });
+			}
+
+			if (!match.Matches)
+			{
+				match.Checks.clear();
+			}
+			any |= match.Matches;
+			step.Types.push_back(std::move(match));
+		}
+		ret._impossible |= !any;
+		ret._steps.push_back(std::move(step));
+	}
+	return ret;
+}
+
+void NodeQuery::Select(std::vector<Node>& results) const
+{
+	results.clear();
+	if (_impossible)
+	{
+		return;
+	}
+
+	auto doc = _document;
+	auto content = doc->Content + doc->NodeRange.Start;
+	auto nodeLength = doc->NodeRange.GetLength();
+	auto typeCount = doc->TypeList.size();
+
+	std::uint64_t lastStep = std::uint64_t{ 1 } << (_steps.size() - 1);
+	std::uint64_t allSteps = lastStep | (lastStep - 1);
+	std::uint64_t descendantSteps = 0;
+	for (std::size_t i = 0; i < _steps.size(); ++i)
+	{
+		if (_steps[i].Descendant)
+		{
+			descendantSteps |= std::uint64_t{ 1 } << i;
+		}
+	}
+
+	struct Frame
+	{
+		std::uint32_t End;
+		std::uint64_t Steps;
+	};
+	std::vector<Frame> stack;
+
+	for (std::uint32_t offset = 0; offset < nodeLength; )
+	{
+		while (!stack.empty() && offset >= stack.back().End)
+		{
+			stack.pop_back();
+		}
+		std::uint64_t active = stack.empty() ? 1 : stack.back().Steps;
+
+		std::uint32_t pos = offset;
+		auto typeIndex = ReadNumberU(content, &pos, doc->TypeWidth);
+		if (typeIndex >= typeCount)
+		{
+			throw ReaderException("Invalid node type");
+		}
+		auto& type = doc->TypeList[typeIndex];
+		auto childrenStart = offset + type.GetTotalLen() + (type.HasChildren() ? doc->NodeWidth : 0);
+		if (childrenStart > nodeLength)
+		{
+			throw ReaderException("Invalid node data");
+		}
+
+		std::uint64_t matched = 0;
+		for (std::size_t i = 0; i < _steps.size(); ++i)
+		{
+			if ((active >> i & 1) == 0) continue;
+			auto& match = _steps[i].Types[typeIndex];
+			if (!match.Matches) continue;
+			bool ok = true;
+			for (auto& check : match.Checks)
+			{
+				std::uint32_t checkPos = offset + check.Offset;
+				if (ReadNumberU(content, &checkPos, check.Width) != check.Expected)
+				{
+					ok = false;
+					break;
+				}
+			}
+			if (ok)
+			{
+				matched |= std::uint64_t{ 1 } << i;
+			}
+		}
+		if (matched & lastStep)
+		{
+			results.push_back({ doc, offset });
+		}
+
+		if (!type.HasChildren())
+		{
+			offset = childrenStart;
+			continue;
+		}
+		auto end = GetNextNode(doc, offset);
+		if (end > nodeLength || end < childrenStart)
+		{
+			throw ReaderException("Invalid node data");
+		}
+		std::uint64_t childSteps = ((matched << 1) & allSteps) | (active & descendantSteps);
+		if (childSteps == 0)
+		{
+			//Nothing can match below this node.
+			offset = end;
+			continue;
+		}
+		stack.push_back({ end, childSteps });
+		offset = childrenStart;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "MapleCodeReader.h"
+
+namespace MapleCode::Reader
+{
+	//A node selector compiled against the type and string tables of one document.
+	//
+	//  query     := step+
+	//  step      := ('/' | '//') name generics? predicate*
+	//  name      := identifier | '*'
+	//  generics  := '<' (identifier | '*') (',' (identifier | '*'))* '>'
+	//  predicate := '[' argument-index '=' (string | integer | float) ']'
+	//
+	//'/' selects children of the previous step (or top-level nodes), '//' selects descendants
+	//at any depth. For example, //func[0="main"]/const<int> selects every const<int> child of
+	//a func node whose first argument is "main".
+	class NodeQuery
+	{
+	private:
+		struct ArgumentCheck
+		{
+			std::uint32_t Offset, Width, Expected;
+		};
+
+		struct TypeMatch
+		{
+			bool Matches = false;
+			std::pmr::vector<ArgumentCheck> Checks;
+
+			explicit TypeMatch(std::pmr::memory_resource* resource) : Checks(resource) {}
+		};
+
+		struct Step
+		{
+			bool Descendant = false;
+			std::pmr::vector<TypeMatch> Types;
+
+			explicit Step(std::pmr::memory_resource* resource) : Types(resource) {}
+		};
+
+		DocumentData* _document;
+		std::pmr::vector<Step> _steps;
+		bool _impossible = false;
+
+		explicit NodeQuery(DocumentData* document) : _document(document), _steps(document->Resource) {}
+
+	public:
+		//The compiled steps are allocated from the document's memory resource.
+		static NodeQuery Compile(Document* doc, const std::string& query);
+
+		void Select(std::vector<Node>& results) const;
+
+		std::vector<Node> Select() const
+		{
+			std::vector<Node> ret;
+			Select(ret);
+			return ret;
+		}
+	};
+}
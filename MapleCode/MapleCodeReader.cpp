@@ -1,27 +1,11 @@
 #include "MapleCodeReader.h"
+#include "MapleCodeInternal.h"
+#include "MapleCodeCompression.h"
 
 using namespace MapleCode::Reader;
+using namespace MapleCode::Reader::Internal;
 
-static const std::uint32_t SizeModeToSize[] = { 0, 1, 2, 4 };
-
-static std::uint32_t ReadNumberU(const void* data, std::uint32_t* pPos, int size)
-{
-	const char* data8 = static_cast<const char*>(data);
-	std::uint32_t ret = 0;
-	std::memcpy(&ret, data8 + *pPos, size);
-	*pPos += size;
-	return ret;
-}
-
-template <typename T, typename RET = std::int32_t>
-static RET ConvertNumber(std::uint32_t val)
-{
-	T ret = {};
-	std::memcpy(&ret, &val, sizeof(T));
-	return static_cast<RET>(ret);
-}
-
-static bool ReadString(const uint8_t* data, const uint8_t* dataEnd, std::string& result)
+static bool ReadString(const uint8_t* data, const uint8_t* dataEnd, std::pmr::vector<std::pmr::string>& results)
 {
 	auto strEnd = std::memchr(data, 0, dataEnd - data);
 	auto strEndChar = static_cast<const uint8_t*>(strEnd);
@@ -29,48 +13,177 @@ static bool ReadString(const uint8_t* data, const uint8_t* dataEnd, std::string&
 	{
 		return false;
 	}
-	result = std::string(data, strEndChar);
+	results.emplace_back(data, strEndChar);
 	return true;
 }
 
-static NodeType* GetNodeType(DocumentData* doc, std::uint32_t offset)
+void DocumentDeleter::operator()(Document* doc) const
+{
+	doc->~Document();
+	Resource->deallocate(doc, sizeof(Document), alignof(Document));
+}
+
+PmrDocumentPtr Document::Allocate(std::pmr::memory_resource* resource)
 {
-	std::uint32_t pos = doc->NodeRange.Start + offset;
-	auto typeIndex = ReadNumberU(doc->Data.get(), &pos, doc->TypeWidth);
-	if (typeIndex > doc->TypeList.size())
+	auto ptr = resource->allocate(sizeof(Document), alignof(Document));
+	try
+	{
+		return PmrDocumentPtr(new (ptr) Document(resource), { resource });
+	}
+	catch (...)
 	{
-		throw ReaderException("Invalid node type");
+		resource->deallocate(ptr, sizeof(Document), alignof(Document));
+		throw;
 	}
-	return &doc->TypeList[typeIndex];
 }
 
-static std::uint32_t GetNextNode(DocumentData* doc, std::uint32_t offset)
+std::unique_ptr<Document> Document::ReadFromData(Document* typeListDoc, const void* data, std::uint32_t length)
 {
-	auto type = GetNodeType(doc, offset);
-	if (type->HasChildren())
+	auto ret = std::make_unique<Document>();
+	ReadFromDataInternal(typeListDoc, const_cast<void*>(data), length, false, false, &ret->Data);
+	return ret;
+}
+
+std::unique_ptr<Document> Document::ReadFromWritableData(Document* typeListDoc, void* data, std::uint32_t length)
+{
+	auto ret = std::make_unique<Document>();
+	ReadFromDataInternal(typeListDoc, data, length, true, false, &ret->Data);
+	return ret;
+}
+
+std::unique_ptr<Document> Document::ReadFromSegmentedData(Document* typeListDoc, const void* data, std::uint32_t length)
+{
+	auto ret = std::make_unique<Document>();
+	ReadFromDataInternal(typeListDoc, const_cast<void*>(data), length, false, true, &ret->Data);
+	return ret;
+}
+
+PmrDocumentPtr Document::ReadFromData(Document* typeListDoc, const void* data, std::uint32_t length,
+	std::pmr::memory_resource* resource)
+{
+	auto ret = Allocate(resource);
+	ReadFromDataInternal(typeListDoc, const_cast<void*>(data), length, false, false, &ret->Data);
+	return ret;
+}
+
+PmrDocumentPtr Document::ReadFromWritableData(Document* typeListDoc, void* data, std::uint32_t length,
+	std::pmr::memory_resource* resource)
+{
+	auto ret = Allocate(resource);
+	ReadFromDataInternal(typeListDoc, data, length, true, false, &ret->Data);
+	return ret;
+}
+
+PmrDocumentPtr Document::ReadFromSegmentedData(Document* typeListDoc, const void* data, std::uint32_t length,
+	std::pmr::memory_resource* resource)
+{
+	auto ret = Allocate(resource);
+	ReadFromDataInternal(typeListDoc, const_cast<void*>(data), length, false, true, &ret->Data);
+	return ret;
+}
+
+namespace
+{
+	struct SegmentInfo
 	{
-		std::uint32_t pos = doc->NodeRange.Start + offset + type->GetTotalLen();
-		auto childrenLen = ReadNumberU(doc->Data.get(), &pos, doc->NodeWidth);
-		return offset + type->GetTotalLen() + doc->NodeWidth + childrenLen;
-	}
-	return offset + type->GetTotalLen();
+		std::uint32_t Start;
+		std::uint32_t StrLength, NodeLength, DataLength;
+	};
 }
 
-static bool ValidateNodeOffset(DocumentData* doc, std::uint32_t offset)
+//Concatenate the sections of the base document and all segments following it. Segments use
+//logical indices and offsets, so the merged sections need no rewriting.
+static void MergeSegments(std::pmr::vector<std::uint8_t>& content, const std::uint8_t* data8, std::uint32_t length,
+	std::uint32_t baseLength, std::uint32_t headerLength, std::uint32_t strWidth, std::uint32_t nodeWidth,
+	std::uint32_t dataWidth, DocumentData::TableRange& strRange, DocumentData::TableRange& typeRange,
+	DocumentData::TableRange& nodeRange, DocumentData::TableRange& dataRange)
 {
-	auto type = GetNodeType(doc, offset);
-	auto nodeEnd = offset + type->GetTotalLen();
-	if (type->HasChildren())
+	std::vector<SegmentInfo> segments;
+	std::uint64_t totalStr = strRange.GetLength(), totalNode = nodeRange.GetLength(), totalData = dataRange.GetLength();
+	auto segmentHeaderLength = 1 + strWidth + nodeWidth + dataWidth;
+	for (std::uint32_t pos = baseLength; pos < length; )
 	{
-		nodeEnd += doc->NodeWidth;
+		if (length - pos < segmentHeaderLength || data8[pos] != data8[0])
+		{
+			throw ReaderException("Invalid segment header");
+		}
+		SegmentInfo segment;
+		std::uint32_t readSizePos = pos + 1;
+		segment.StrLength = ReadNumberU(data8, &readSizePos, strWidth);
+		segment.NodeLength = ReadNumberU(data8, &readSizePos, nodeWidth);
+		segment.DataLength = ReadNumberU(data8, &readSizePos, dataWidth);
+		segment.Start = readSizePos;
+		std::uint64_t segmentEnd = std::uint64_t{ readSizePos } + segment.StrLength + segment.NodeLength + segment.DataLength;
+		if (segmentEnd > length)
+		{
+			throw ReaderException("Cannot read to the end of segment");
+		}
+		totalStr += segment.StrLength;
+		totalNode += segment.NodeLength;
+		totalData += segment.DataLength;
+		segments.push_back(segment);
+		pos = static_cast<std::uint32_t>(segmentEnd);
 	}
-	return nodeEnd <= doc->NodeRange.GetLength();
+
+	auto typeLength = typeRange.GetLength();
+	if (totalStr + typeLength + totalNode + totalData > UINT32_MAX)
+	{
+		throw ReaderException("Segmented document too large");
+	}
+	content.resize(static_cast<std::size_t>(totalStr + typeLength + totalNode + totalData));
+	auto base = data8 + headerLength;
+	std::uint32_t strPos = 0, typePos = static_cast<std::uint32_t>(totalStr), nodePos = typePos + typeLength,
+		dataPos = nodePos + static_cast<std::uint32_t>(totalNode);
+
+	auto append = [&](std::uint32_t* pPos, const std::uint8_t* src, std::uint32_t len)
+	{
+		std::memcpy(content.data() + *pPos, src, len);
+		*pPos += len;
+	};
+	append(&strPos, base + strRange.Start, strRange.GetLength());
+	append(&typePos, base + typeRange.Start, typeLength);
+	append(&nodePos, base + nodeRange.Start, nodeRange.GetLength());
+	append(&dataPos, base + dataRange.Start, dataRange.GetLength());
+	for (auto& segment : segments)
+	{
+		auto segmentData = data8 + segment.Start;
+		append(&strPos, segmentData, segment.StrLength);
+		append(&nodePos, segmentData + segment.StrLength, segment.NodeLength);
+		append(&dataPos, segmentData + segment.StrLength + segment.NodeLength, segment.DataLength);
+	}
+
+	strRange = { 0, strPos };
+	typeRange = { strPos, typePos };
+	nodeRange = { typeRange.End, nodePos };
+	dataRange = { nodeRange.End, dataPos };
 }
 
-std::unique_ptr<Document> Document::ReadFromData(Document* typeListDoc, const void* data, std::uint32_t length)
+void Document::ReadFromDataInternal(Document* typeListDoc, void* data, std::uint32_t length,
+	bool writable, bool segmented, DocumentData* result)
 {
-	const std::uint8_t* data8 = static_cast<const uint8_t*>(data);
-	std::uint8_t sizeMode = data8[0];
+	auto resource = result->Resource;
+	std::uint8_t* data8 = static_cast<uint8_t*>(data);
+	std::uint32_t headerStart = 0;
+	std::uint8_t flags = 0;
+	if (data8[0] == ExtendedHeaderMarker)
+	{
+		if (length < 3)
+		{
+			throw ReaderException("Cannot read to the end of document");
+		}
+		flags = data8[1];
+		if ((flags & ~DocumentFlagCompressedData) != 0)
+		{
+			throw ReaderException("Unsupported document flags");
+		}
+		headerStart = 2;
+	}
+	bool compressed = (flags & DocumentFlagCompressedData) != 0;
+	if (compressed && segmented)
+	{
+		throw ReaderException("Compressed documents cannot have segments");
+	}
+	std::uint8_t sizeMode = data8[headerStart];
 
 	std::uint32_t strWidth = SizeModeToSize[(sizeMode >> 0) & 3];
 	std::uint32_t typeWidth = SizeModeToSize[(sizeMode >> 2) & 3];
@@ -78,7 +191,7 @@ std::unique_ptr<Document> Document::ReadFromData(Document* typeListDoc, const vo
 	std::uint32_t dataWidth = SizeModeToSize[(sizeMode >> 6) & 3];
 
 	DocumentData::TableRange strRange, typeRange, nodeRange, dataRange;
-	std::uint32_t readSizePos = 1;
+	std::uint32_t readSizePos = headerStart + 1;
 	strRange.End = ReadNumberU(data, &readSizePos, strWidth);
 	typeRange.End = ReadNumberU(data, &readSizePos, typeWidth);
 	nodeRange.End = ReadNumberU(data, &readSizePos, nodeWidth);
@@ -97,33 +210,64 @@ std::unique_ptr<Document> Document::ReadFromData(Document* typeListDoc, const vo
 	nodeRange.Move(typeRange.End);
 	dataRange.Move(nodeRange.End);
 
-	auto headerLength = 1 + strWidth + typeWidth + nodeWidth + dataWidth;
-	auto totalLength = headerLength + dataRange.End;
+	auto headerLength = headerStart + 1 + strWidth + typeWidth + nodeWidth + dataWidth;
+	auto totalLength = headerLength + (compressed ? nodeRange.End : dataRange.End);
 	if (length < totalLength)
 	{
 		throw ReaderException("Cannot read to the end of document");
 	}
 
-	auto content = std::make_unique<std::uint8_t[]>(dataRange.End);
-	std::memcpy(content.get(), data8 + headerLength, dataRange.End);
-	
-	std::vector<std::string> stringTable;
-	for (auto pos = strRange.Start; pos < strRange.End; )
+	//The compressed payload takes the place of the data section, directly after the nodes.
+	std::uint32_t payloadLength = compressed ?
+		CompressedDataSection::MeasurePayload(data8 + totalLength, length - totalLength, dataRange.GetLength()) : 0;
+
+	std::pmr::vector<std::uint8_t> ownedContent(resource);
+	std::uint8_t* content = data8 + headerLength;
+	if (segmented)
 	{
-		std::int32_t dataOffset = dataRange.Start + ReadNumberU(content.get(), &pos, dataWidth);
-		std::string str;
-		if (!ReadString(content.get() + dataOffset, content.get() + dataRange.End, str))
+		MergeSegments(ownedContent, data8, length, totalLength, headerLength, strWidth, nodeWidth, dataWidth,
+			strRange, typeRange, nodeRange, dataRange);
+		content = ownedContent.data();
+		if (typeListDoc == nullptr && typeRange.GetLength() == 0 && nodeRange.GetLength() != 0)
 		{
-			throw ReaderException("Invalid string data");
+			throw ReaderException("No node type list specified");
 		}
-		stringTable.push_back(str);
+	}
+	else if (!writable)
+	{
+		auto contentLength = compressed ? nodeRange.End + payloadLength : dataRange.End;
+		ownedContent.assign(content, content + contentLength);
+		content = ownedContent.data();
+	}
+
+	std::shared_ptr<CompressedDataSection> compressedData;
+	if (compressed)
+	{
+		compressedData = std::allocate_shared<CompressedDataSection>(
+			std::pmr::polymorphic_allocator<CompressedDataSection>(resource), content + nodeRange.End, payloadLength,
+			dataRange.GetLength(), resource);
 	}
 
-	std::vector<NodeType> typeList;
-	std::vector<std::uint32_t> argSizes = {
+	//Strings of a compressed document are resolved on demand by DocumentData::GetString.
+	std::pmr::vector<std::pmr::string> stringTable(resource);
+	std::uint32_t stringCount = strRange.GetLength() / dataWidth;
+	if (!compressed)
+	{
+		for (auto pos = strRange.Start; pos < strRange.End; )
+		{
+			std::uint32_t dataOffset = ReadNumberU(content, &pos, dataWidth);
+			if (!ReadString(content + dataRange.Start + dataOffset, content + dataRange.End, stringTable))
+			{
+				throw ReaderException("Invalid string data");
+			}
+		}
+	}
+
+	std::pmr::vector<NodeType> typeList(resource);
+	std::pmr::vector<std::uint32_t> argSizes({
 		1, 2, 4, 1, 2, 4, 4,
 		strWidth, dataWidth * 2, nodeWidth, nodeWidth + strWidth,
-	};
+	}, resource);
 	if (typeListDoc != nullptr)
 	{
 		typeList = typeListDoc->Data.TypeList;
@@ -132,53 +276,121 @@ std::unique_ptr<Document> Document::ReadFromData(Document* typeListDoc, const vo
 	{
 		for (auto pos = typeRange.Start; pos < typeRange.End; )
 		{
-			std::uint32_t strIndex = ReadNumberU(content.get(), &pos, strWidth);
-			if (strIndex < 0 || strIndex > stringTable.size())
+			std::uint32_t strIndex = ReadNumberU(content, &pos, strWidth);
+			if (strIndex >= stringCount)
 			{
 				throw ReaderException("Invalid string index");
 			}
-			std::uint32_t dataOffset = ReadNumberU(content.get(), &pos, dataWidth);
+			std::uint32_t dataOffset = ReadNumberU(content, &pos, dataWidth);
 			if (dataOffset < 0 || dataOffset >= dataRange.GetLength())
 			{
 				throw ReaderException("Invalid data offset");
 			}
 			std::uint8_t genericCount = content[pos++];
 			std::uint8_t hasChild = content[pos++];
-			std::uint8_t argCount = content[dataRange.Start + dataOffset];
+			std::uint8_t argCount;
+			if (compressed)
+			{
+				compressedData->Read(dataOffset, dataOffset + 1, &argCount);
+			}
+			else
+			{
+				argCount = content[dataRange.Start + dataOffset];
+			}
 			if (dataOffset + 1 + argCount > dataRange.GetLength())
 			{
 				throw ReaderException("Invalid data offset");
 			}
-			std::vector<NodeArgumentType> args;
-			args.resize(argCount);
-			std::memcpy(args.data(), content.get() + dataRange.Start + dataOffset + 1, argCount);
+			std::pmr::vector<NodeArgumentType> args(argCount, resource);
+			if (compressed)
+			{
+				compressedData->Read(dataOffset + 1, dataOffset + 1 + argCount, args.data());
+			}
+			else
+			{
+				std::memcpy(args.data(), content + dataRange.Start + dataOffset + 1, argCount);
+			}
 			std::uint32_t nodeLen = typeWidth;
 			nodeLen += strWidth * genericCount;
 			for (auto tt : args)
 			{
 				nodeLen += argSizes[(int)tt];
 			}
-			typeList.emplace_back(stringTable[strIndex], genericCount, std::move(args), hasChild != 0, nodeLen);
+			if (compressed)
+			{
+				auto namePos = strRange.Start + strIndex * dataWidth;
+				std::string name;
+				if (!compressedData->ReadString(ReadNumberU(content, &namePos, dataWidth), name))
+				{
+					throw ReaderException("Invalid string data");
+				}
+				typeList.emplace_back(std::pmr::string(name, resource), genericCount, std::move(args),
+					hasChild != 0, nodeLen);
+			}
+			else
+			{
+				typeList.emplace_back(stringTable[strIndex], genericCount, std::move(args), hasChild != 0, nodeLen);
+			}
 		}
 	}
 
-	auto ret = std::make_unique<Document>();
-	ret->Data.Data = std::move(content);
-	ret->Data.StrWidth = strWidth;
-	ret->Data.TypeWidth = typeWidth;
-	ret->Data.NodeWidth = nodeWidth;
-	ret->Data.DataWidth = dataWidth;
-	ret->Data.StrList = std::move(stringTable);
-	ret->Data.TypeList = std::move(typeList);
-	ret->Data.StrRange = strRange;
-	ret->Data.TypeRange = typeRange;
-	ret->Data.NodeRange = nodeRange;
-	ret->Data.DataRange = dataRange;
-	ret->Data.ArgumentWidth = std::move(argSizes);
+	result->Data = std::move(ownedContent);
+	result->Content = content;
+	result->Writable = writable;
+	result->StrWidth = strWidth;
+	result->TypeWidth = typeWidth;
+	result->NodeWidth = nodeWidth;
+	result->DataWidth = dataWidth;
+	result->StrList = std::move(stringTable);
+	result->TypeList = std::move(typeList);
+	result->StrRange = strRange;
+	result->TypeRange = typeRange;
+	result->NodeRange = nodeRange;
+	result->DataRange = dataRange;
+	result->ArgumentWidth = std::move(argSizes);
+	result->CompressedData = std::move(compressedData);
+}
+
+std::uint32_t DocumentData::GetStringCount() const
+{
+	return CompressedData ? StrRange.GetLength() / DataWidth : static_cast<std::uint32_t>(StrList.size());
+}
 
+std::string DocumentData::GetString(std::uint32_t index) const
+{
+	if (index >= GetStringCount())
+	{
+		throw ReaderException("Invalid string index");
+	}
+	if (!CompressedData)
+	{
+		return std::string(StrList[index]);
+	}
+	auto pos = StrRange.Start + index * DataWidth;
+	std::string ret;
+	if (!CompressedData->ReadString(ReadNumberU(Content, &pos, DataWidth), ret))
+	{
+		throw ReaderException("Invalid string data");
+	}
 	return ret;
 }
 
+void DocumentData::CopyData(std::uint32_t begin, std::uint32_t end, void* buffer) const
+{
+	if (end < begin || end > DataRange.GetLength())
+	{
+		throw ReaderException("Invalid data offset");
+	}
+	if (CompressedData)
+	{
+		CompressedData->Read(begin, end, buffer);
+	}
+	else if (end > begin)
+	{
+		std::memcpy(buffer, Content + DataRange.Start + begin, end - begin);
+	}
+}
+
 NodeRange::NodeIterator& NodeRange::NodeIterator::operator++()
 {
 	_offset = GetNextNode(_document, _offset);
@@ -196,7 +408,7 @@ void NodeRange::NodeIterator::ValidateInternalNode() const
 
 NodeType* Node::GetNodeType() const
 {
-	return ::GetNodeType(_document, _offset);
+	return Internal::GetNodeType(_document, _offset);
 }
 
 void Node::ReadGenericArguments(std::vector<std::string>& results) const
@@ -207,12 +419,8 @@ void Node::ReadGenericArguments(std::vector<std::string>& results) const
 	std::uint32_t pos = _document->NodeRange.Start + _offset + _document->TypeWidth;
 	for (std::uint32_t i = 0; i < type->GetGenericArgCount(); ++i)
 	{
-		auto strIndex = ReadNumberU(_document->Data.get(), &pos, _document->StrWidth);
-		if (strIndex > _document->StrList.size())
-		{
-			throw ReaderException("Invalid string index");
-		}
-		results.push_back(_document->StrList[strIndex]);
+		auto strIndex = ReadNumberU(_document->Content, &pos, _document->StrWidth);
+		results.push_back(_document->GetString(strIndex));
 	}
 }
 
@@ -243,7 +451,7 @@ NodeRange Node::GetChildren() const
 	std::uint32_t pos = _document->NodeRange.Start + cstart;
 	if (type->HasChildren())
 	{
-		auto clen = ReadNumberU(_document->Data.get(), &pos, _document->NodeWidth);
+		auto clen = ReadNumberU(_document->Content, &pos, _document->NodeWidth);
 		if (clen + _offset > _document->NodeRange.GetLength())
 		{
 			throw ReaderException("Invalid node data");
@@ -334,12 +542,7 @@ std::string NodeArgument::GetString()
 	{
 		throw ReaderException("Incorrect argument type");
 	}
-	auto index = ReadArgNumber(_document->StrWidth);
-	if (index > _document->StrList.size())
-	{
-		throw ReaderException("Invalid string index");
-	}
-	return _document->StrList[index];
+	return _document->GetString(ReadArgNumber(_document->StrWidth));
 }
 
 float NodeArgument::GetFloat()
@@ -368,38 +571,152 @@ Node NodeArgument::GetNode()
 std::tuple<Node, std::string> MapleCode::Reader::NodeArgument::GetField()
 {
 	std::uint32_t pos = _document->NodeRange.Start + _offset;
-	auto node = ReadNumberU(_document->Data.get(), &pos, _document->NodeWidth);
+	auto node = ReadNumberU(_document->Content, &pos, _document->NodeWidth);
 	if (!ValidateNodeOffset(_document, node))
 	{
 		throw ReaderException("Invalid node data");
 	}
 
-	auto field = ReadNumberU(_document->Data.get(), &pos, _document->StrWidth);
-	if (field > _document->StrList.size())
-	{
-		throw ReaderException("Invalid string index");
-	}
-	return { { _document, node }, _document->StrList[field] };
+	auto field = ReadNumberU(_document->Content, &pos, _document->StrWidth);
+	return { { _document, node }, _document->GetString(field) };
 }
 
 std::uint32_t NodeArgument::ReadArgNumber(int size)
 {
 	std::uint32_t pos = _document->NodeRange.Start + _offset;
-	return ReadNumberU(_document->Data.get(), &pos, size);
+	return ReadNumberU(_document->Content, &pos, size);
 }
 
 void NodeArgument::GetDataRange(std::uint32_t* pBegin, std::uint32_t* pEnd)
 {
 	std::uint32_t pos = _document->NodeRange.Start + _offset;
-	*pBegin = ReadNumberU(_document->Data.get(), &pos, _document->DataWidth);
-	*pEnd = ReadNumberU(_document->Data.get(), &pos, _document->DataWidth);
+	*pBegin = ReadNumberU(_document->Content, &pos, _document->DataWidth);
+	*pEnd = ReadNumberU(_document->Content, &pos, _document->DataWidth);
 }
 
 void NodeArgument::FillData(void* buffer, std::uint32_t begin, std::uint32_t end)
 {
-	if (end < begin || end > _document->DataRange.End)
+	_document->CopyData(begin, end, buffer);
+}
+
+bool NodeArgument::SetSigned(std::int32_t value)
+{
+	CheckWritable();
+	switch (_type)
 	{
-		throw ReaderException("Invalid data offset");
+	case NodeArgumentType::S8:
+		if (value < INT8_MIN || value > INT8_MAX) return false;
+		WriteArgNumber(static_cast<std::uint32_t>(value), 1);
+		return true;
+	case NodeArgumentType::S16:
+		if (value < INT16_MIN || value > INT16_MAX) return false;
+		WriteArgNumber(static_cast<std::uint32_t>(value), 2);
+		return true;
+	case NodeArgumentType::S32:
+		WriteArgNumber(static_cast<std::uint32_t>(value), 4);
+		return true;
+	}
+	throw ReaderException("Incorrect argument type");
+}
+
+bool NodeArgument::SetUnsigned(std::uint32_t value)
+{
+	CheckWritable();
+	switch (_type)
+	{
+	case NodeArgumentType::U8:
+		if (value > UINT8_MAX) return false;
+		WriteArgNumber(value, 1);
+		return true;
+	case NodeArgumentType::U16:
+		if (value > UINT16_MAX) return false;
+		WriteArgNumber(value, 2);
+		return true;
+	case NodeArgumentType::U32:
+		WriteArgNumber(value, 4);
+		return true;
+	}
+	throw ReaderException("Incorrect argument type");
+}
+
+bool NodeArgument::SetFloat(float value)
+{
+	CheckWritable();
+	if (_type != NodeArgumentType::F32)
+	{
+		throw ReaderException("Incorrect argument type");
+	}
+	std::uint32_t val;
+	std::memcpy(&val, &value, 4);
+	WriteArgNumber(val, 4);
+	return true;
+}
+
+bool NodeArgument::SetString(std::uint32_t stringIndex)
+{
+	CheckWritable();
+	if (_type != NodeArgumentType::STR)
+	{
+		throw ReaderException("Incorrect argument type");
+	}
+	if (stringIndex >= _document->GetStringCount())
+	{
+		throw ReaderException("Invalid string index");
+	}
+	if (!FitsWidth(stringIndex, _document->StrWidth)) return false;
+	WriteArgNumber(stringIndex, _document->StrWidth);
+	return true;
+}
+
+bool NodeArgument::SetNode(const Node& node)
+{
+	CheckWritable();
+	if (_type != NodeArgumentType::REF)
+	{
+		throw ReaderException("Incorrect argument type");
+	}
+	if (node.GetDocumentData() != _document || !IsNodeStart(_document, node.GetOffset()))
+	{
+		throw ReaderException("Invalid node data");
+	}
+	if (!FitsWidth(node.GetOffset(), _document->NodeWidth)) return false;
+	WriteArgNumber(node.GetOffset(), _document->NodeWidth);
+	return true;
+}
+
+bool NodeArgument::SetField(const Node& node, std::uint32_t stringIndex)
+{
+	CheckWritable();
+	if (_type != NodeArgumentType::REFFIELD)
+	{
+		throw ReaderException("Incorrect argument type");
+	}
+	if (node.GetDocumentData() != _document || !IsNodeStart(_document, node.GetOffset()))
+	{
+		throw ReaderException("Invalid node data");
+	}
+	if (stringIndex >= _document->GetStringCount())
+	{
+		throw ReaderException("Invalid string index");
+	}
+	if (!FitsWidth(node.GetOffset(), _document->NodeWidth) || !FitsWidth(stringIndex, _document->StrWidth))
+	{
+		return false;
+	}
+	WriteArgNumber(node.GetOffset(), _document->NodeWidth);
+	WriteArgNumber(stringIndex, _document->StrWidth, _document->NodeWidth);
+	return true;
+}
+
+void NodeArgument::WriteArgNumber(std::uint32_t value, int size, int offset)
+{
+	std::memcpy(_document->Content + _document->NodeRange.Start + _offset + offset, &value, size);
+}
+
+void NodeArgument::CheckWritable()
+{
+	if (!_document->Writable)
+	{
+		throw ReaderException("Document is read-only");
 	}
-	std::memcpy(buffer, _document->Data.get() + _document->DataRange.Start + begin, end - begin);
 }
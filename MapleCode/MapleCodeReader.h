@@ -1,5 +1,6 @@
 #pragma once
 #include <memory>
+#include <memory_resource>
 #include <vector>
 #include <string>
 #include <cstdint>
@@ -10,6 +11,7 @@ namespace MapleCode::Reader
 	struct NodeArgument;
 	struct DocumentData;
 	struct NodeRange;
+	class CompressedDataSection;
 
 	class ReaderException : public std::exception
 	{
@@ -35,24 +37,47 @@ namespace MapleCode::Reader
 	class NodeType
 	{
 	private:
-		std::string _name;
+		std::pmr::string _name;
 		std::uint32_t _genericArgCount;
-		std::vector<NodeArgumentType> _argumentTypes;
+		std::pmr::vector<NodeArgumentType> _argumentTypes;
 		bool _hasChildren;
 		std::uint32_t _totalLen;
 
 	public:
-		NodeType(std::string name, std::uint8_t genericCount, std::vector<NodeArgumentType>&& args,
-			bool hasChildren, std::uint32_t totalLen)
-			: _name(std::move(name)), _genericArgCount(genericCount), _argumentTypes(std::move(args)),
+		//Allocator-aware, so that a std::pmr::vector<NodeType> places the name and argument
+		//list in the same memory resource as the vector itself.
+		typedef std::pmr::polymorphic_allocator<char> allocator_type;
+
+		NodeType(const std::pmr::string& name, std::uint8_t genericCount, std::pmr::vector<NodeArgumentType>&& args,
+			bool hasChildren, std::uint32_t totalLen, const allocator_type& alloc = {})
+			: _name(name, alloc), _genericArgCount(genericCount), _argumentTypes(std::move(args), alloc),
 			_hasChildren(hasChildren), _totalLen(totalLen)
 		{
 		}
 
-		std::string GetName() { return _name; }
+		NodeType(const NodeType& other, const allocator_type& alloc = {})
+			: _name(other._name, alloc), _genericArgCount(other._genericArgCount),
+			_argumentTypes(other._argumentTypes, alloc), _hasChildren(other._hasChildren),
+			_totalLen(other._totalLen)
+		{
+		}
+
+		NodeType(NodeType&& other) = default;
+
+		NodeType(NodeType&& other, const allocator_type& alloc)
+			: _name(std::move(other._name), alloc), _genericArgCount(other._genericArgCount),
+			_argumentTypes(std::move(other._argumentTypes), alloc), _hasChildren(other._hasChildren),
+			_totalLen(other._totalLen)
+		{
+		}
+
+		NodeType& operator=(const NodeType&) = default;
+		NodeType& operator=(NodeType&&) = default;
+
+		std::string GetName() { return std::string(_name); }
 		std::uint32_t GetGenericArgCount() { return _genericArgCount; }
 
-		const std::vector<NodeArgumentType>& GetArgumentTypes()
+		const std::pmr::vector<NodeArgumentType>& GetArgumentTypes()
 		{
 			return _argumentTypes;
 		}
@@ -75,6 +100,7 @@ namespace MapleCode::Reader
 
 		bool IsNull() const { return _document == nullptr; }
 		std::uint32_t GetOffset() const { return _offset; }
+		DocumentData* GetDocumentData() const { return _document; }
 
 		NodeType* GetNodeType() const;
 		void ReadGenericArguments(std::vector<std::string>& results) const;
@@ -163,6 +189,10 @@ namespace MapleCode::Reader
 			void ValidateInternalNode() const;
 		};
 
+		DocumentData* GetDocumentData() const { return _document; }
+		std::uint32_t GetBeginOffset() const { return _begin; }
+		std::uint32_t GetEndOffset() const { return _end; }
+
 		NodeIterator begin() { return { _document, _begin, { _document, _begin } }; }
 		NodeIterator end() { return { _document, _end, { _document, _end } }; }
 
@@ -211,8 +241,22 @@ namespace MapleCode::Reader
 		Node GetNode();
 		std::tuple<Node, std::string> GetField();
 
+		//Setters write directly into the node section of a writable document. They return
+		//false without changing anything if the value does not fit the encoded width.
+		//SetNode and SetField only accept the start of a node in the same document. Changing a
+		//reference makes a DocumentIndex of the document stale: its sidecar no longer attaches
+		//and an index that is already attached must be rebuilt.
+		bool SetSigned(std::int32_t value);
+		bool SetUnsigned(std::uint32_t value);
+		bool SetFloat(float value);
+		bool SetString(std::uint32_t stringIndex);
+		bool SetNode(const Node& node);
+		bool SetField(const Node& node, std::uint32_t stringIndex);
+
 	private:
 		std::uint32_t ReadArgNumber(int size);
+		void WriteArgNumber(std::uint32_t value, int size, int offset = 0);
+		void CheckWritable();
 		void GetDataRange(std::uint32_t* pBegin, std::uint32_t* pEnd);
 		void FillData(void* buffer, std::uint32_t begin, std::uint32_t end);
 	};
@@ -235,28 +279,98 @@ namespace MapleCode::Reader
 			}
 		};
 
-		std::unique_ptr<std::uint8_t[]> Data;
+		std::pmr::memory_resource* Resource;
+		std::pmr::vector<std::uint8_t> Data;
+		std::uint8_t* Content = nullptr;
+		bool Writable = false;
 		int StrWidth = 0, TypeWidth = 0, NodeWidth = 0, DataWidth = 0;
 
-		std::vector<std::string> StrList;
-		std::vector<NodeType> TypeList;
+		//String table of an uncompressed document. Empty if the data section is compressed, use
+		//GetStringCount and GetString to access strings of any document.
+		std::pmr::vector<std::pmr::string> StrList;
+		std::pmr::vector<NodeType> TypeList;
 
 		TableRange StrRange, TypeRange, NodeRange, DataRange;
 
-		std::vector<std::uint32_t> ArgumentWidth;
+		std::pmr::vector<std::uint32_t> ArgumentWidth;
+
+		//Set if the data section is block-compressed. Content then holds the compressed
+		//payload instead of the data section, and data must be read with CopyData.
+		std::shared_ptr<CompressedDataSection> CompressedData;
+
+		//Copy bytes [begin, end) of the data section.
+		void CopyData(std::uint32_t begin, std::uint32_t end, void* buffer) const;
+
+		std::uint32_t GetStringCount() const;
+		//Strings of a compressed document are read through the block cache on each call.
+		std::string GetString(std::uint32_t index) const;
+
+		explicit DocumentData(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: Resource(resource), Data(resource), StrList(resource), TypeList(resource), ArgumentWidth(resource)
+		{
+		}
+
+		//Content points into Data (or a caller-owned buffer), which a copy would not rebind.
+		DocumentData(const DocumentData&) = delete;
+		DocumentData& operator=(const DocumentData&) = delete;
+	};
+
+	//Destroys a document allocated from a memory resource.
+	struct DocumentDeleter
+	{
+		std::pmr::memory_resource* Resource = nullptr;
+
+		void operator()(Document* doc) const;
 	};
 
+	typedef std::unique_ptr<Document, DocumentDeleter> PmrDocumentPtr;
+
 	class Document
 	{
 	private:
 		DocumentData Data;
 
+		static void ReadFromDataInternal(Document* typeList, void* data, std::uint32_t length,
+			bool writable, bool segmented, DocumentData* result);
+		static PmrDocumentPtr Allocate(std::pmr::memory_resource* resource);
+
 	public:
+		explicit Document(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: Data(resource)
+		{
+		}
+
+		//Nodes keep a pointer to the document data, so documents are not copied.
+		Document(const Document&) = delete;
+		Document& operator=(const Document&) = delete;
+
 		static std::unique_ptr<Document> ReadFromData(Document* typeList, const void* data, std::uint32_t length);
 
+		//Read a document without copying it. Arguments can then be patched in place with the
+		//NodeArgument::Set* functions. The buffer must outlive the document.
+		static std::unique_ptr<Document> ReadFromWritableData(Document* typeList, void* data, std::uint32_t length);
+
+		//Read a base document followed by any number of appended segments (see SegmentBuilder)
+		//as a single logical document.
+		static std::unique_ptr<Document> ReadFromSegmentedData(Document* typeList, const void* data, std::uint32_t length);
+
+		//Overloads placing the document, its content buffer and its string and type tables in
+		//the given memory resource, which must outlive the returned document.
+		static PmrDocumentPtr ReadFromData(Document* typeList, const void* data, std::uint32_t length,
+			std::pmr::memory_resource* resource);
+		static PmrDocumentPtr ReadFromWritableData(Document* typeList, void* data, std::uint32_t length,
+			std::pmr::memory_resource* resource);
+		static PmrDocumentPtr ReadFromSegmentedData(Document* typeList, const void* data, std::uint32_t length,
+			std::pmr::memory_resource* resource);
+
 		NodeRange GetAllNodes()
 		{
 			return { &Data, 0, Data.NodeRange.End - Data.NodeRange.Start };
 		}
+
+		DocumentData* GetDocumentData()
+		{
+			return &Data;
+		}
 	};
 }
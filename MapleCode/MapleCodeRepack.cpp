@@ -0,0 +1,444 @@
+#include "MapleCodeRepack.h"
+#include "MapleCodeInternal.h"
+#include <algorithm>
+#include <unordered_map>
+
+using namespace MapleCode::Reader;
+using namespace MapleCode::Reader::Internal;
+
+namespace
+{
+	const std::uint32_t Unused = 0xFFFFFFFF;
+
+	struct Widths
+	{
+		std::uint32_t Str, Type, Node, Data;
+	};
+
+	//Number of slots of each width in the node section, used to compute its length for
+	//any candidate SizeMode without rewriting the nodes.
+	struct NodeSlotCount
+	{
+		std::uint64_t Type = 0, Str = 0, Node = 0, Data = 0, Fixed = 0;
+
+		std::uint64_t GetLength(const Widths& w) const
+		{
+			return Type * w.Type + Str * w.Str + Node * w.Node + Data * w.Data + Fixed;
+		}
+	};
+
+	struct TypeEntry
+	{
+		std::uint32_t Name;
+		std::uint32_t Arguments;
+		std::uint8_t GenericCount;
+		bool HasChildren;
+	};
+
+	class DataSectionWriter
+	{
+	private:
+		bool _deduplicate;
+		std::unordered_map<std::string, std::uint32_t> _strings;
+		std::unordered_map<std::string, std::uint32_t> _blobs;
+
+	public:
+		std::vector<std::uint8_t> Data;
+		std::vector<std::uint32_t> StringOffsets;
+
+		DataSectionWriter(bool deduplicate) : _deduplicate(deduplicate) {}
+
+		std::uint32_t AddString(const std::string& str)
+		{
+			auto it = _strings.find(str);
+			if (it != _strings.end())
+			{
+				return it->second;
+			}
+			auto index = static_cast<std::uint32_t>(StringOffsets.size());
+			StringOffsets.push_back(static_cast<std::uint32_t>(Data.size()));
+			Data.insert(Data.end(), str.begin(), str.end());
+			Data.push_back(0);
+			_strings.emplace(str, index);
+			return index;
+		}
+
+		std::uint32_t AddBlob(const std::uint8_t* data, std::uint32_t length, bool deduplicate)
+		{
+			std::string key;
+			if (deduplicate)
+			{
+				key.assign(reinterpret_cast<const char*>(data), length);
+				auto it = _blobs.find(key);
+				if (it != _blobs.end())
+				{
+					return it->second;
+				}
+			}
+			auto offset = static_cast<std::uint32_t>(Data.size());
+			Data.insert(Data.end(), data, data + length);
+			if (deduplicate)
+			{
+				_blobs.emplace(std::move(key), offset);
+			}
+			return offset;
+		}
+
+		std::uint32_t AddBlob(const std::uint8_t* data, std::uint32_t length)
+		{
+			return AddBlob(data, length, _deduplicate);
+		}
+	};
+
+	bool EnsureWidth(std::uint32_t* pWidth, std::uint64_t value)
+	{
+		if (FitsWidth(value, *pWidth))
+		{
+			return false;
+		}
+		if (*pWidth == 4)
+		{
+			throw ReaderException("Document too large");
+		}
+		*pWidth *= 2;
+		return true;
+	}
+
+	Widths ComputeWidths(std::uint32_t minimum, std::size_t strCount, std::size_t typeCount,
+		std::size_t typeTableCount, const NodeSlotCount& nodeSlots, std::size_t dataLength)
+	{
+		if (minimum != 1 && minimum != 2 && minimum != 4)
+		{
+			throw ReaderException("Invalid minimum width");
+		}
+		Widths w = { minimum, minimum, minimum, minimum };
+		bool changed = true;
+		while (changed)
+		{
+			changed = false;
+			changed |= EnsureWidth(&w.Str, strCount == 0 ? 0 : strCount - 1);
+			changed |= EnsureWidth(&w.Str, strCount * w.Data);
+			changed |= EnsureWidth(&w.Type, typeCount == 0 ? 0 : typeCount - 1);
+			changed |= EnsureWidth(&w.Type, typeTableCount * (w.Str + w.Data + 2));
+			changed |= EnsureWidth(&w.Node, nodeSlots.GetLength(w));
+			changed |= EnsureWidth(&w.Data, dataLength);
+		}
+		return w;
+	}
+
+	//Writes the header, string table and type table. The node section (of the given length)
+	//and the data section are appended by the caller.
+	void WriteHeader(std::vector<std::uint8_t>& output, const Widths& w, const DataSectionWriter& data,
+		const std::vector<TypeEntry>& types, std::uint32_t nodeLength, std::uint8_t flags = 0)
+	{
+		if (flags != 0)
+		{
+			output.push_back(ExtendedHeaderMarker);
+			output.push_back(flags);
+		}
+		auto strLength = static_cast<std::uint32_t>(data.StringOffsets.size() * w.Data);
+		auto typeLength = static_cast<std::uint32_t>(types.size() * (w.Str + w.Data + 2));
+		auto dataLength = static_cast<std::uint32_t>(data.Data.size());
+
+		output.push_back(static_cast<std::uint8_t>(WidthToSizeMode(w.Str) | WidthToSizeMode(w.Type) << 2 |
+			WidthToSizeMode(w.Node) << 4 | WidthToSizeMode(w.Data) << 6));
+		AppendNumber(output, strLength, w.Str);
+		AppendNumber(output, typeLength, w.Type);
+		AppendNumber(output, nodeLength, w.Node);
+		AppendNumber(output, dataLength, w.Data);
+
+		output.reserve(output.size() + strLength + typeLength + nodeLength + dataLength);
+		for (auto offset : data.StringOffsets)
+		{
+			AppendNumber(output, offset, w.Data);
+		}
+		for (auto& type : types)
+		{
+			AppendNumber(output, type.Name, w.Str);
+			AppendNumber(output, type.Arguments, w.Data);
+			output.push_back(type.GenericCount);
+			output.push_back(type.HasChildren ? 1 : 0);
+		}
+	}
+
+	std::uint32_t GetArgumentWidth(NodeArgumentType type, const Widths& w)
+	{
+		switch (type)
+		{
+		case NodeArgumentType::STR:
+			return w.Str;
+		case NodeArgumentType::DAT:
+			return w.Data * 2;
+		case NodeArgumentType::REF:
+			return w.Node;
+		case NodeArgumentType::REFFIELD:
+			return w.Node + w.Str;
+		case NodeArgumentType::U8:
+		case NodeArgumentType::S8:
+			return 1;
+		case NodeArgumentType::U16:
+		case NodeArgumentType::S16:
+			return 2;
+		default:
+			return 4;
+		}
+	}
+
+	std::vector<TypeEntry> AddTypes(DataSectionWriter& data, const std::vector<NodeType*>& types)
+	{
+		std::vector<TypeEntry> ret;
+		for (auto type : types)
+		{
+			auto& args = type->GetArgumentTypes();
+			std::vector<std::uint8_t> argData;
+			argData.push_back(static_cast<std::uint8_t>(args.size()));
+			for (auto tt : args)
+			{
+				argData.push_back(static_cast<std::uint8_t>(tt));
+			}
+			TypeEntry entry;
+			entry.Name = data.AddString(type->GetName());
+			entry.Arguments = data.AddBlob(argData.data(), static_cast<std::uint32_t>(argData.size()), true);
+			entry.GenericCount = static_cast<std::uint8_t>(type->GetGenericArgCount());
+			entry.HasChildren = type->HasChildren();
+			ret.push_back(entry);
+		}
+		return ret;
+	}
+}
+
+RepackResult MapleCode::Reader::Repack(Document* doc, const RepackOptions& options)
+{
+	auto src = doc->GetDocumentData();
+	auto content = src->Content;
+	auto nodeLength = src->NodeRange.GetLength();
+
+	std::vector<bool> strUsed(src->GetStringCount());
+	std::vector<bool> typeUsed(src->TypeList.size());
+	std::vector<std::uint32_t> offsets;
+	std::vector<std::uint32_t> payloads;
+	std::vector<std::uint8_t> payloadBuffer;
+	NodeSlotCount slots;
+	DataSectionWriter data(options.DeduplicateData);
+
+	auto markString = [&](std::uint32_t* pPos)
+	{
+		auto index = ReadNumberU(content, pPos, src->StrWidth);
+		if (index >= strUsed.size())
+		{
+			throw ReaderException("Invalid string index");
+		}
+		strUsed[index] = true;
+	};
+
+	//First pass: collect referenced strings, types and data payloads.
+	for (std::uint32_t offset = 0; offset < nodeLength; )
+	{
+		if (!ValidateNodeOffset(src, offset))
+		{
+			throw ReaderException("Invalid node data");
+		}
+		offsets.push_back(offset);
+		auto type = GetNodeType(src, offset);
+		typeUsed[type - src->TypeList.data()] = true;
+
+		std::uint32_t pos = src->NodeRange.Start + offset + src->TypeWidth;
+		slots.Type += 1;
+		for (std::uint32_t i = 0; i < type->GetGenericArgCount(); ++i)
+		{
+			markString(&pos);
+			slots.Str += 1;
+		}
+		for (auto tt : type->GetArgumentTypes())
+		{
+			switch (tt)
+			{
+			case NodeArgumentType::STR:
+				markString(&pos);
+				slots.Str += 1;
+				break;
+			case NodeArgumentType::DAT:
+			{
+				auto begin = ReadNumberU(content, &pos, src->DataWidth);
+				auto end = ReadNumberU(content, &pos, src->DataWidth);
+				if (end < begin || end > src->DataRange.GetLength())
+				{
+					throw ReaderException("Invalid data offset");
+				}
+				auto newBegin = data.AddBlob(GetDataBytes(src, begin, end, payloadBuffer), end - begin);
+				payloads.push_back(newBegin);
+				slots.Data += 2;
+				break;
+			}
+			case NodeArgumentType::REF:
+				pos += src->NodeWidth;
+				slots.Node += 1;
+				break;
+			case NodeArgumentType::REFFIELD:
+				pos += src->NodeWidth;
+				markString(&pos);
+				slots.Node += 1;
+				slots.Str += 1;
+				break;
+			default:
+				pos += src->ArgumentWidth[(int)tt];
+				slots.Fixed += src->ArgumentWidth[(int)tt];
+				break;
+			}
+		}
+		offset += type->GetTotalLen();
+		if (type->HasChildren())
+		{
+			offset += src->NodeWidth;
+			slots.Node += 1;
+		}
+	}
+
+	std::vector<std::uint32_t> strMap(strUsed.size(), Unused);
+	for (std::uint32_t i = 0; i < strUsed.size(); ++i)
+	{
+		if (strUsed[i])
+		{
+			strMap[i] = data.AddString(src->GetString(i));
+		}
+	}
+
+	std::vector<std::uint32_t> typeMap(src->TypeList.size(), Unused);
+	std::vector<NodeType*> usedTypes;
+	for (std::size_t i = 0; i < src->TypeList.size(); ++i)
+	{
+		if (typeUsed[i])
+		{
+			typeMap[i] = static_cast<std::uint32_t>(usedTypes.size());
+			usedTypes.push_back(&src->TypeList[i]);
+		}
+	}
+
+	RepackResult ret;
+	std::vector<TypeEntry> types;
+	if (options.ExternalizeTypes)
+	{
+		DataSectionWriter typeData(true);
+		auto typeListTypes = AddTypes(typeData, usedTypes);
+		auto tw = ComputeWidths(options.MinimumWidth, typeData.StringOffsets.size(), typeListTypes.size(),
+			typeListTypes.size(), {}, typeData.Data.size());
+		WriteHeader(ret.TypeList, tw, typeData, typeListTypes, 0);
+		ret.TypeList.insert(ret.TypeList.end(), typeData.Data.begin(), typeData.Data.end());
+	}
+	else
+	{
+		types = AddTypes(data, usedTypes);
+	}
+
+	auto w = ComputeWidths(options.MinimumWidth, data.StringOffsets.size(), usedTypes.size(),
+		types.size(), slots, data.Data.size());
+
+	std::vector<std::uint32_t> typeLength;
+	for (auto type : usedTypes)
+	{
+		std::uint32_t len = w.Type + w.Str * type->GetGenericArgCount();
+		for (auto tt : type->GetArgumentTypes())
+		{
+			len += GetArgumentWidth(tt, w);
+		}
+		typeLength.push_back(len);
+	}
+
+	//Second pass: compute the new offset of every node.
+	std::vector<std::uint32_t> newOffsets;
+	newOffsets.reserve(offsets.size());
+	std::uint32_t newNodeLength = 0;
+	for (auto offset : offsets)
+	{
+		newOffsets.push_back(newNodeLength);
+		auto type = GetNodeType(src, offset);
+		newNodeLength += typeLength[typeMap[type - src->TypeList.data()]];
+		if (type->HasChildren())
+		{
+			newNodeLength += w.Node;
+		}
+	}
+
+	auto mapOffset = [&](std::uint32_t offset)
+	{
+		if (offset == nodeLength)
+		{
+			return newNodeLength;
+		}
+		auto it = std::lower_bound(offsets.begin(), offsets.end(), offset);
+		if (it == offsets.end() || *it != offset)
+		{
+			throw ReaderException("Invalid node data");
+		}
+		return newOffsets[it - offsets.begin()];
+	};
+
+	//Third pass: write the node section directly into the output.
+	auto& output = ret.Document;
+	WriteHeader(output, w, data, types, newNodeLength,
+		options.CompressData ? DocumentFlagCompressedData : 0);
+	auto nextPayload = payloads.begin();
+	for (std::size_t n = 0; n < offsets.size(); ++n)
+	{
+		auto offset = offsets[n];
+		auto type = GetNodeType(src, offset);
+		auto newType = typeMap[type - src->TypeList.data()];
+		AppendNumber(output, newType, w.Type);
+
+		std::uint32_t pos = src->NodeRange.Start + offset + src->TypeWidth;
+		for (std::uint32_t i = 0; i < type->GetGenericArgCount(); ++i)
+		{
+			AppendNumber(output, strMap[ReadNumberU(content, &pos, src->StrWidth)], w.Str);
+		}
+		for (auto tt : type->GetArgumentTypes())
+		{
+			switch (tt)
+			{
+			case NodeArgumentType::STR:
+				AppendNumber(output, strMap[ReadNumberU(content, &pos, src->StrWidth)], w.Str);
+				break;
+			case NodeArgumentType::DAT:
+			{
+				auto begin = ReadNumberU(content, &pos, src->DataWidth);
+				auto end = ReadNumberU(content, &pos, src->DataWidth);
+				auto newBegin = *nextPayload++;
+				AppendNumber(output, newBegin, w.Data);
+				AppendNumber(output, newBegin + (end - begin), w.Data);
+				break;
+			}
+			case NodeArgumentType::REF:
+				AppendNumber(output, mapOffset(ReadNumberU(content, &pos, src->NodeWidth)), w.Node);
+				break;
+			case NodeArgumentType::REFFIELD:
+				AppendNumber(output, mapOffset(ReadNumberU(content, &pos, src->NodeWidth)), w.Node);
+				AppendNumber(output, strMap[ReadNumberU(content, &pos, src->StrWidth)], w.Str);
+				break;
+			default:
+			{
+				auto width = src->ArgumentWidth[(int)tt];
+				output.insert(output.end(), content + pos, content + pos + width);
+				pos += width;
+				break;
+			}
+			}
+		}
+		if (type->HasChildren())
+		{
+			auto childrenStart = newOffsets[n] + typeLength[newType] + w.Node;
+			auto childrenEnd = mapOffset(GetNextNode(src, offset));
+			AppendNumber(output, childrenEnd - childrenStart, w.Node);
+		}
+	}
+	if (options.CompressData)
+	{
+		auto payload = CompressedDataSection::Compress(data.Data.data(),
+			static_cast<std::uint32_t>(data.Data.size()), options.CompressionBlockSize);
+		output.insert(output.end(), payload.begin(), payload.end());
+	}
+	else
+	{
+		output.insert(output.end(), data.Data.begin(), data.Data.end());
+	}
+
+	return ret;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "MapleCodeReader.h"
+#include "MapleCodeCompression.h"
+
+namespace MapleCode::Reader
+{
+	struct RepackOptions
+	{
+		//Write the type table into a separate type list document instead of the output document.
+		bool ExternalizeTypes = false;
+		//Store identical DAT payloads only once.
+		bool DeduplicateData = true;
+		//Smallest width (1, 2 or 4) used for the SizeMode fields.
+		std::uint32_t MinimumWidth = 1;
+		//Store the data section as compressed blocks (see CompressedDataSection).
+		bool CompressData = false;
+		std::uint32_t CompressionBlockSize = CompressedDataSection::DefaultBlockSize;
+	};
+
+	struct RepackResult
+	{
+		std::vector<std::uint8_t> Document;
+		std::vector<std::uint8_t> TypeList;
+	};
+
+	//Rewrite a document with only the strings and types it references and the smallest
+	//SizeMode that fits, remapping all STR, REF, REFFIELD and DAT arguments.
+	RepackResult Repack(Document* doc, const RepackOptions& options = {});
+}
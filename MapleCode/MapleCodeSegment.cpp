@@ -0,0 +1,211 @@
+#include "MapleCodeSegment.h"
+#include "MapleCodeInternal.h"
+#include <algorithm>
+
+using namespace MapleCode::Reader;
+using namespace MapleCode::Reader::Internal;
+
+SegmentBuilder::SegmentBuilder(Document* doc)
+	: _document(doc->GetDocumentData()), _strings(_document->Resource), _strTable(_document->Resource),
+	_nodes(_document->Resource), _data(_document->Resource), _openChildren(_document->Resource),
+	_nodeStarts(_document->Resource)
+{
+	if (_document->CompressedData)
+	{
+		throw ReaderException("Compressed documents cannot have segments");
+	}
+	_nodeBase = _document->NodeRange.GetLength();
+	_dataBase = _document->DataRange.GetLength();
+	_strCount = _document->GetStringCount();
+	for (std::uint32_t i = 0; i < _strCount; ++i)
+	{
+		_strings.emplace(std::pmr::string(_document->GetString(i), _document->Resource), i);
+	}
+}
+
+std::uint32_t SegmentBuilder::AddString(const std::string& str)
+{
+	auto it = _strings.find(std::pmr::string(str));
+	if (it != _strings.end())
+	{
+		return it->second;
+	}
+	if (!FitsWidth(_strCount, _document->StrWidth))
+	{
+		throw ReaderException("Too many strings for document SizeMode");
+	}
+	auto offset = AddData(str.c_str(), static_cast<std::uint32_t>(str.size() + 1));
+	AppendNumber(_strTable, offset, _document->DataWidth);
+	_strings.emplace(std::pmr::string(str, _document->Resource), _strCount);
+	return _strCount++;
+}
+
+std::uint32_t SegmentBuilder::AddData(const void* data, std::uint32_t length)
+{
+	auto begin = _dataBase + static_cast<std::uint32_t>(_data.size());
+	if (!FitsWidth(std::uint64_t{ begin } + length, _document->DataWidth))
+	{
+		throw ReaderException("Data section too large for document SizeMode");
+	}
+	auto data8 = static_cast<const std::uint8_t*>(data);
+	_data.insert(_data.end(), data8, data8 + length);
+	return begin;
+}
+
+std::uint32_t SegmentBuilder::WriteNode(std::uint32_t type, const std::vector<std::uint32_t>& generics,
+	const std::vector<SegmentArgument>& args)
+{
+	if (type >= _document->TypeList.size())
+	{
+		throw ReaderException("Invalid node type");
+	}
+	auto& nodeType = _document->TypeList[type];
+	auto& argTypes = nodeType.GetArgumentTypes();
+	if (generics.size() != nodeType.GetGenericArgCount() || args.size() != argTypes.size())
+	{
+		throw ReaderException("Incorrect argument count");
+	}
+
+	auto offset = _nodeBase + static_cast<std::uint32_t>(_nodes.size());
+	auto checkString = [&](std::uint32_t index)
+	{
+		if (index >= _strCount)
+		{
+			throw ReaderException("Invalid string index");
+		}
+		return index;
+	};
+	auto checkNode = [&](std::uint32_t target)
+	{
+		auto isNodeStart = target < _nodeBase ? IsNodeStart(_document, target) :
+			std::binary_search(_nodeStarts.begin(), _nodeStarts.end(), target);
+		if (!isNodeStart)
+		{
+			throw ReaderException("Invalid node data");
+		}
+		return target;
+	};
+	auto checkRange = [](bool inRange)
+	{
+		if (!inRange)
+		{
+			throw ReaderException("Argument value out of range");
+		}
+	};
+
+	//Remove a partly written node if an argument is rejected.
+	auto start = _nodes.size();
+	try
+	{
+		AppendNumber(_nodes, type, _document->TypeWidth);
+		for (auto g : generics)
+		{
+			AppendNumber(_nodes, checkString(g), _document->StrWidth);
+		}
+		for (std::size_t i = 0; i < args.size(); ++i)
+		{
+			auto& arg = args[i];
+			auto signedValue = static_cast<std::int32_t>(arg.Value);
+			switch (argTypes[i])
+			{
+			case NodeArgumentType::U8:
+				checkRange(arg.Value <= UINT8_MAX);
+				break;
+			case NodeArgumentType::U16:
+				checkRange(arg.Value <= UINT16_MAX);
+				break;
+			case NodeArgumentType::S8:
+				checkRange(signedValue >= INT8_MIN && signedValue <= INT8_MAX);
+				break;
+			case NodeArgumentType::S16:
+				checkRange(signedValue >= INT16_MIN && signedValue <= INT16_MAX);
+				break;
+			case NodeArgumentType::STR:
+				checkString(arg.Value);
+				break;
+			case NodeArgumentType::DAT:
+				checkRange(arg.Value <= arg.Extra && arg.Extra <= _dataBase + _data.size());
+				break;
+			case NodeArgumentType::REF:
+				checkNode(arg.Value);
+				break;
+			case NodeArgumentType::REFFIELD:
+				checkNode(arg.Value);
+				checkString(arg.Extra);
+				break;
+			}
+
+			switch (argTypes[i])
+			{
+			case NodeArgumentType::DAT:
+				AppendNumber(_nodes, arg.Value, _document->DataWidth);
+				AppendNumber(_nodes, arg.Extra, _document->DataWidth);
+				break;
+			case NodeArgumentType::REFFIELD:
+				AppendNumber(_nodes, arg.Value, _document->NodeWidth);
+				AppendNumber(_nodes, arg.Extra, _document->StrWidth);
+				break;
+			default:
+				AppendNumber(_nodes, arg.Value, _document->ArgumentWidth[(int)argTypes[i]]);
+				break;
+			}
+		}
+
+		if (nodeType.HasChildren())
+		{
+			_openChildren.push_back(_nodes.size());
+			AppendNumber(_nodes, 0, _document->NodeWidth);
+		}
+		if (!FitsWidth(_nodeBase + _nodes.size(), _document->NodeWidth))
+		{
+			throw ReaderException("Node section too large for document SizeMode");
+		}
+	}
+	catch (...)
+	{
+		_nodes.resize(start);
+		if (!_openChildren.empty() && _openChildren.back() >= start)
+		{
+			_openChildren.pop_back();
+		}
+		throw;
+	}
+	_nodeStarts.push_back(offset);
+	return offset;
+}
+
+void SegmentBuilder::EndChildren()
+{
+	if (_openChildren.empty())
+	{
+		throw ReaderException("No open children list");
+	}
+	auto pos = _openChildren.back();
+	_openChildren.pop_back();
+	auto len = static_cast<std::uint32_t>(_nodes.size() - pos - _document->NodeWidth);
+	std::memcpy(_nodes.data() + pos, &len, _document->NodeWidth);
+}
+
+std::vector<std::uint8_t> SegmentBuilder::Finish()
+{
+	if (!_openChildren.empty())
+	{
+		throw ReaderException("Children list not closed");
+	}
+	if (!FitsWidth(_strTable.size(), _document->StrWidth))
+	{
+		throw ReaderException("Too many strings for document SizeMode");
+	}
+
+	std::vector<std::uint8_t> ret;
+	ret.push_back(static_cast<std::uint8_t>(WidthToSizeMode(_document->StrWidth) |
+		WidthToSizeMode(_document->TypeWidth) << 2 | WidthToSizeMode(_document->NodeWidth) << 4 |
+		WidthToSizeMode(_document->DataWidth) << 6));
+	AppendNumber(ret, static_cast<std::uint32_t>(_strTable.size()), _document->StrWidth);
+	AppendNumber(ret, static_cast<std::uint32_t>(_nodes.size()), _document->NodeWidth);
+	AppendNumber(ret, static_cast<std::uint32_t>(_data.size()), _document->DataWidth);
+	ret.insert(ret.end(), _strTable.begin(), _strTable.end());
+	ret.insert(ret.end(), _nodes.begin(), _nodes.end());
+	ret.insert(ret.end(), _data.begin(), _data.end());
+	return ret;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "MapleCodeReader.h"
+#include <cstring>
+#include <memory_resource>
+#include <unordered_map>
+
+namespace MapleCode::Reader
+{
+	//Raw value of a node argument. Numbers are stored by bit pattern, STR is a string index,
+	//DAT is a (begin, end) data offset pair, REF is a node offset, and REFFIELD is a
+	//(node offset, string index) pair.
+	struct SegmentArgument
+	{
+		std::uint32_t Value = 0, Extra = 0;
+
+		SegmentArgument(std::uint32_t value) : Value(value) {}
+		SegmentArgument(std::int32_t value) : Value(static_cast<std::uint32_t>(value)) {}
+		SegmentArgument(float value) { std::memcpy(&Value, &value, 4); }
+		SegmentArgument(std::uint32_t value, std::uint32_t extra) : Value(value), Extra(extra) {}
+	};
+
+	//Builds a segment to be appended after a document (or after its previous segments). The
+	//segment uses the SizeMode and type list of the document, and all string indices, data
+	//offsets and node offsets are logical: they continue those of the document, so new nodes
+	//can refer back to the start of any existing node. Read the result with
+	//Document::ReadFromSegmentedData and use Repack to fold the segments into a standard document.
+	class SegmentBuilder
+	{
+	private:
+		DocumentData* _document;
+		std::uint32_t _nodeBase, _dataBase;
+		std::pmr::unordered_map<std::pmr::string, std::uint32_t> _strings;
+		std::uint32_t _strCount;
+		std::pmr::vector<std::uint8_t> _strTable, _nodes, _data;
+		std::pmr::vector<std::size_t> _openChildren;
+		//Offsets of the nodes written so far, in increasing order.
+		std::pmr::vector<std::uint32_t> _nodeStarts;
+
+	public:
+		//The pending segment is allocated from the document's memory resource.
+		SegmentBuilder(Document* doc);
+
+		std::uint32_t AddString(const std::string& str);
+		std::uint32_t AddData(const void* data, std::uint32_t length);
+
+		//Write a top-level node (or a child of the innermost open node) and return its offset.
+		//Nodes of a type with children open a children list that must be closed by EndChildren.
+		std::uint32_t WriteNode(std::uint32_t type, const std::vector<std::uint32_t>& generics,
+			const std::vector<SegmentArgument>& args);
+		void EndChildren();
+
+		std::vector<std::uint8_t> Finish();
+	};
+}
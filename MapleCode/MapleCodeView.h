@@ -0,0 +1,228 @@
+#pragma once
+#include "MapleCodeReader.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <tuple>
+
+namespace MapleCode::Reader
+{
+	//Static description of a node type. Derive from it and add the type name:
+	//
+	//  struct ConstNode : NodeSchema<1, false, NodeArgumentType::U32>
+	//  {
+	//      static constexpr const char* Name = "const";
+	//  };
+	template <std::uint8_t GenericCount, bool Children, NodeArgumentType... Args>
+	struct NodeSchema
+	{
+		static constexpr std::uint32_t GenericArgCount = GenericCount;
+		static constexpr bool HasChildren = Children;
+		static constexpr std::array<NodeArgumentType, sizeof...(Args)> ArgumentTypes = { Args... };
+	};
+
+	template <typename Schema>
+	class NodeBinding;
+
+	//Typed access to the arguments of a node whose type has been checked by NodeBinding.
+	//Argument offsets are copied from the binding, so the view does not refer to it, and
+	//numeric arguments are read with their compile-time size, so no per-access type check
+	//or switch is needed.
+	template <typename Schema>
+	class NodeView
+	{
+		friend class NodeBinding<Schema>;
+
+	public:
+		typedef std::array<std::uint32_t, Schema::ArgumentTypes.size()> ArgumentOffsets;
+
+	private:
+		DocumentData* _document;
+		ArgumentOffsets _argumentOffsets;
+		std::uint32_t _childrenOffset;
+		std::uint32_t _offset;
+
+		NodeView(DocumentData* doc, const ArgumentOffsets& argumentOffsets, std::uint32_t childrenOffset,
+			std::uint32_t offset)
+			: _document(doc), _argumentOffsets(argumentOffsets), _childrenOffset(childrenOffset), _offset(offset)
+		{
+		}
+
+		template <typename T>
+		static T Read(const std::uint8_t* p)
+		{
+			T ret;
+			std::memcpy(&ret, p, sizeof(T));
+			return ret;
+		}
+
+		static std::uint32_t ReadWidth(const std::uint8_t* p, int width)
+		{
+			std::uint32_t ret = 0;
+			std::memcpy(&ret, p, width);
+			return ret;
+		}
+
+		const std::uint8_t* GetNodeData() const
+		{
+			auto doc = _document;
+			return doc->Content + doc->NodeRange.Start + _offset;
+		}
+
+		std::string GetStringAt(const std::uint8_t* p) const
+		{
+			return _document->GetString(ReadWidth(p, _document->StrWidth));
+		}
+
+	public:
+		Node GetNode() const
+		{
+			return { _document, _offset };
+		}
+
+		std::string GetGeneric(std::uint32_t index) const
+		{
+			if (index >= Schema::GenericArgCount)
+			{
+				throw ReaderException("Invalid generic argument index");
+			}
+			auto doc = _document;
+			return GetStringAt(GetNodeData() + doc->TypeWidth + doc->StrWidth * index);
+		}
+
+		template <std::size_t I>
+		auto Get() const
+		{
+			static_assert(I < Schema::ArgumentTypes.size(), "Argument index out of range");
+			constexpr NodeArgumentType type = Schema::ArgumentTypes[I];
+			auto doc = _document;
+			auto p = GetNodeData() + _argumentOffsets[I];
+
+			if constexpr (type == NodeArgumentType::U8) return std::uint32_t{ Read<std::uint8_t>(p) };
+			else if constexpr (type == NodeArgumentType::U16) return std::uint32_t{ Read<std::uint16_t>(p) };
+			else if constexpr (type == NodeArgumentType::U32) return Read<std::uint32_t>(p);
+			else if constexpr (type == NodeArgumentType::S8) return std::int32_t{ Read<std::int8_t>(p) };
+			else if constexpr (type == NodeArgumentType::S16) return std::int32_t{ Read<std::int16_t>(p) };
+			else if constexpr (type == NodeArgumentType::S32) return Read<std::int32_t>(p);
+			else if constexpr (type == NodeArgumentType::F32) return Read<float>(p);
+			else if constexpr (type == NodeArgumentType::STR) return GetStringAt(p);
+			else if constexpr (type == NodeArgumentType::REF) return Node{ doc, ReadWidth(p, doc->NodeWidth) };
+			else if constexpr (type == NodeArgumentType::REFFIELD)
+			{
+				return std::tuple<Node, std::string>{ Node{ doc, ReadWidth(p, doc->NodeWidth) },
+					GetStringAt(p + doc->NodeWidth) };
+			}
+			else if constexpr (type == NodeArgumentType::DAT)
+			{
+				auto begin = ReadWidth(p, doc->DataWidth);
+				auto end = ReadWidth(p + doc->DataWidth, doc->DataWidth);
+				return std::make_tuple(begin, end);
+			}
+		}
+
+		template <std::size_t I, typename T>
+		void GetData(std::vector<T>& result) const
+		{
+			static_assert(Schema::ArgumentTypes[I] == NodeArgumentType::DAT, "Argument is not DAT");
+			auto doc = _document;
+			auto [begin, end] = Get<I>();
+			auto len = end - begin;
+			if (end < begin || end > doc->DataRange.GetLength() || len % sizeof(T) != 0)
+			{
+				throw ReaderException("Invalid data offset");
+			}
+			result.resize(len / sizeof(T));
+			doc->CopyData(begin, end, result.data());
+		}
+
+		NodeRange GetChildren() const
+		{
+			static_assert(Schema::HasChildren, "Node type has no children");
+			auto doc = _document;
+			auto clen = ReadWidth(GetNodeData() + _childrenOffset, doc->NodeWidth);
+			auto cstart = _offset + _childrenOffset + doc->NodeWidth;
+			return { doc, cstart, cstart + clen };
+		}
+	};
+
+	//Binds a schema to the type table of one document. All checks against the type
+	//definition happen in Bind; views created from the binding only read the node data.
+	template <typename Schema>
+	class NodeBinding
+	{
+	private:
+		DocumentData* _document = nullptr;
+		std::vector<bool> _boundTypes;
+		std::uint32_t _boundCount = 0;
+		typename NodeView<Schema>::ArgumentOffsets _argumentOffsets = {};
+		std::uint32_t _childrenOffset = 0;
+
+	public:
+		//Throws ReaderException if the document has a type with the schema's name but a
+		//different definition. A document may define the same type more than once, and
+		//every matching definition is bound. If the document has no such type, the binding
+		//matches no node.
+		static NodeBinding Bind(Document* doc)
+		{
+			NodeBinding ret;
+			ret._document = doc->GetDocumentData();
+			auto& types = ret._document->TypeList;
+			ret._boundTypes.resize(types.size());
+			for (std::uint32_t i = 0; i < types.size(); ++i)
+			{
+				auto& type = types[i];
+				if (type.GetName() != Schema::Name)
+				{
+					continue;
+				}
+				auto& args = type.GetArgumentTypes();
+				if (type.GetGenericArgCount() != Schema::GenericArgCount ||
+					type.HasChildren() != Schema::HasChildren ||
+					args.size() != Schema::ArgumentTypes.size() ||
+					!std::equal(args.begin(), args.end(), Schema::ArgumentTypes.begin()))
+				{
+					throw ReaderException("Node type does not match schema");
+				}
+				ret._boundTypes[i] = true;
+				ret._boundCount += 1;
+			}
+
+			std::uint32_t offset = ret._document->TypeWidth + ret._document->StrWidth * Schema::GenericArgCount;
+			for (std::size_t i = 0; i < Schema::ArgumentTypes.size(); ++i)
+			{
+				ret._argumentOffsets[i] = offset;
+				offset += ret._document->ArgumentWidth[(int)Schema::ArgumentTypes[i]];
+			}
+			ret._childrenOffset = offset;
+			return ret;
+		}
+
+		bool IsBound() const { return _boundCount != 0; }
+		bool IsBoundType(std::uint32_t typeIndex) const
+		{
+			return typeIndex < _boundTypes.size() && _boundTypes[typeIndex];
+		}
+
+		bool Matches(const Node& node) const
+		{
+			if (node.GetDocumentData() != _document || _boundCount == 0)
+			{
+				return false;
+			}
+			std::uint32_t typeIndex = 0;
+			std::memcpy(&typeIndex, _document->Content + _document->NodeRange.Start + node.GetOffset(),
+				_document->TypeWidth);
+			return IsBoundType(typeIndex);
+		}
+
+		//The view keeps its own copy of the offsets and may outlive the binding.
+		NodeView<Schema> View(const Node& node) const
+		{
+			if (!Matches(node))
+			{
+				throw ReaderException("Node type does not match schema");
+			}
+			return { _document, _argumentOffsets, _childrenOffset, node.GetOffset() };
+		}
+	};
+}
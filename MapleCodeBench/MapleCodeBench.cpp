@@ -0,0 +1,506 @@
+#include "../MapleCode/MapleCodeParallel.h"
+#include "../MapleCode/MapleCodeQuery.h"
+#include "../MapleCode/MapleCodeRepack.h"
+#include "../MapleCode/MapleCodeSegment.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <thread>
+
+using namespace MapleCode::Reader;
+
+namespace
+{
+	struct BenchOptions
+	{
+		//Multiplies the size of the generated documents.
+		std::uint32_t Scale = 1;
+		//Threads used by the multithreaded benchmarks. 0 uses the hardware concurrency.
+		std::uint32_t Threads = 0;
+
+		std::uint32_t GetThreadCount() const
+		{
+			return Threads != 0 ? Threads : std::max(1u, std::thread::hardware_concurrency());
+		}
+	};
+
+	//Types of the generated documents.
+	const std::uint32_t TypeGroup = 0; //group(U32 id) with children
+	const std::uint32_t TypeItem = 1;  //item(U32 value, STR name)
+	const std::uint32_t TypeBlob = 2;  //blob(DAT payload)
+
+	void AppendU32(std::vector<std::uint8_t>& output, std::uint32_t value)
+	{
+		auto pos = output.size();
+		output.resize(pos + 4);
+		std::memcpy(output.data() + pos, &value, 4);
+	}
+
+	//A document with the type table above, no nodes and 4-byte fields, so that any number of
+	//nodes can be appended as a segment.
+	std::vector<std::uint8_t> CreateBaseDocument()
+	{
+		const char data[] =
+			"group\0\x01\x02"
+			"item\0\x02\x02\x07"
+			"blob\0\x01\x08";
+		std::uint32_t dataLength = sizeof(data) - 1;
+
+		std::vector<std::uint8_t> ret = { 0xFF };
+		AppendU32(ret, 3 * 4);
+		AppendU32(ret, 3 * 10);
+		AppendU32(ret, 0);
+		AppendU32(ret, dataLength);
+		for (std::uint32_t offset : { 0u, 8u, 16u })
+		{
+			AppendU32(ret, offset);
+		}
+		std::uint32_t types[][3] = { { 0, 6, 1 }, { 1, 13, 0 }, { 2, 21, 0 } };
+		for (auto& type : types)
+		{
+			AppendU32(ret, type[0]);
+			AppendU32(ret, type[1]);
+			ret.push_back(0);
+			ret.push_back(static_cast<std::uint8_t>(type[2]));
+		}
+		ret.insert(ret.end(), data, data + dataLength);
+		return ret;
+	}
+
+	//Write nodes with the callback and repack the result into a standard document.
+	std::vector<std::uint8_t> GenerateDocument(const std::function<void(SegmentBuilder&)>& generate,
+		const RepackOptions& options = {})
+	{
+		auto file = CreateBaseDocument();
+		auto base = Document::ReadFromSegmentedData(nullptr, file.data(), static_cast<std::uint32_t>(file.size()));
+		SegmentBuilder builder(base.get());
+		generate(builder);
+		auto segment = builder.Finish();
+		file.insert(file.end(), segment.begin(), segment.end());
+		auto doc = Document::ReadFromSegmentedData(nullptr, file.data(), static_cast<std::uint32_t>(file.size()));
+		return Repack(doc.get(), options).Document;
+	}
+
+	//Average milliseconds per call of fn over the given number of iterations.
+	double Measure(int iterations, const std::function<void()>& fn)
+	{
+		auto begin = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; ++i)
+		{
+			fn();
+		}
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(end - begin).count() / iterations;
+	}
+
+	std::size_t CountNodes(NodeRange range)
+	{
+		std::size_t ret = 0;
+		for (auto& node : range)
+		{
+			ret += 1 + CountNodes(node.GetChildren());
+		}
+		return ret;
+	}
+
+	//Compiled query against a hand-written traversal selecting the same nodes: every item
+	//named "name7" that is a direct child of a group, at any depth.
+	void BenchmarkQuery(const BenchOptions& options)
+	{
+		auto scale = options.Scale;
+		auto file = GenerateDocument([&](SegmentBuilder& builder)
+			{
+				std::vector<std::uint32_t> names;
+				for (int i = 0; i < 100; ++i)
+				{
+					names.push_back(builder.AddString("name" + std::to_string(i)));
+				}
+				for (std::uint32_t g = 0; g < scale * 100; ++g)
+				{
+					builder.WriteNode(TypeGroup, {}, { g });
+					for (std::uint32_t i = 0; i < 20; ++i)
+					{
+						builder.WriteNode(TypeItem, {}, { i, names[(g + i) % names.size()] });
+					}
+					builder.WriteNode(TypeGroup, {}, { g });
+					for (std::uint32_t i = 0; i < 20; ++i)
+					{
+						builder.WriteNode(TypeItem, {}, { i, names[(g * 3 + i) % names.size()] });
+					}
+					builder.EndChildren();
+					builder.EndChildren();
+				}
+			});
+		auto doc = Document::ReadFromData(nullptr, file.data(), static_cast<std::uint32_t>(file.size()));
+		const int iterations = 20;
+
+		std::vector<Node> results;
+		auto compileTime = Measure(iterations, [&]() { NodeQuery::Compile(doc.get(), "//group/item[1=\"name7\"]"); });
+		auto query = NodeQuery::Compile(doc.get(), "//group/item[1=\"name7\"]");
+		auto queryTime = Measure(iterations, [&]() { query.Select(results); });
+		auto queryCount = results.size();
+
+		NodeType* groupType = nullptr;
+		NodeType* itemType = nullptr;
+		for (auto& type : doc->GetDocumentData()->TypeList)
+		{
+			auto name = type.GetName();
+			groupType = name == "group" ? &type : groupType;
+			itemType = name == "item" ? &type : itemType;
+		}
+		std::function<void(NodeRange, bool)> visit;
+		std::vector<NodeArgument> args;
+		visit = [&](NodeRange range, bool inGroup)
+		{
+			for (auto& node : range)
+			{
+				auto type = node.GetNodeType();
+				if (type->HasChildren())
+				{
+					visit(node.GetChildren(), type == groupType);
+				}
+				else if (inGroup && type == itemType)
+				{
+					node.ReadArguments(args);
+					if (args[1].GetString() == "name7")
+					{
+						results.push_back(node);
+					}
+				}
+			}
+		};
+		auto handTime = Measure(iterations, [&]()
+			{
+				results.clear();
+				visit(doc->GetAllNodes(), false);
+			});
+
+		std::cout << "query: " << CountNodes(doc->GetAllNodes()) << " nodes, " << queryCount << " matches ("
+			<< results.size() << " hand-written)" << std::endl;
+		std::cout << "  compile      " << compileTime << " ms" << std::endl;
+		std::cout << "  select       " << queryTime << " ms" << std::endl;
+		std::cout << "  hand-written " << handTime << " ms" << std::endl;
+	}
+
+	//Many threads each loading many small documents, with the default allocator against one
+	//arena per thread that is released after every batch.
+	void BenchmarkLoad(const BenchOptions& options)
+	{
+		auto file = GenerateDocument([&](SegmentBuilder& builder)
+			{
+				for (std::uint32_t g = 0; g < 4; ++g)
+				{
+					builder.WriteNode(TypeGroup, {}, { g });
+					for (std::uint32_t i = 0; i < 8; ++i)
+					{
+						builder.WriteNode(TypeItem, {}, { i, builder.AddString("name" + std::to_string(g * 8 + i)) });
+					}
+					builder.EndChildren();
+				}
+			});
+		auto length = static_cast<std::uint32_t>(file.size());
+		auto threadCount = options.GetThreadCount();
+		const std::uint32_t batches = 20 * options.Scale, batchSize = 500;
+
+		auto runThreads = [&](const std::function<void()>& fn)
+		{
+			return Measure(1, [&]()
+				{
+					std::vector<std::thread> threads;
+					for (std::uint32_t t = 0; t < threadCount; ++t)
+					{
+						threads.emplace_back(fn);
+					}
+					for (auto& thread : threads)
+					{
+						thread.join();
+					}
+				});
+		};
+
+		auto defaultTime = runThreads([&]()
+			{
+				std::vector<std::unique_ptr<Document>> docs;
+				for (std::uint32_t b = 0; b < batches; ++b)
+				{
+					for (std::uint32_t i = 0; i < batchSize; ++i)
+					{
+						docs.push_back(Document::ReadFromData(nullptr, file.data(), length));
+					}
+					docs.clear();
+				}
+			});
+		auto arenaTime = runThreads([&]()
+			{
+				std::pmr::monotonic_buffer_resource arena;
+				std::vector<PmrDocumentPtr> docs;
+				for (std::uint32_t b = 0; b < batches; ++b)
+				{
+					for (std::uint32_t i = 0; i < batchSize; ++i)
+					{
+						docs.push_back(Document::ReadFromData(nullptr, file.data(), length, &arena));
+					}
+					docs.clear();
+					arena.release();
+				}
+			});
+
+		auto total = static_cast<double>(threadCount) * batches * batchSize;
+		std::cout << "load: " << threadCount << " threads, " << total << " documents of " << length << " bytes" << std::endl;
+		std::cout << "  default allocator " << defaultTime << " ms (" << defaultTime * 1e6 / total << " ns/document)" << std::endl;
+		std::cout << "  arena per thread  " << arenaTime << " ms (" << arenaTime * 1e6 / total << " ns/document)" << std::endl;
+	}
+
+	//Per-thread result of the node callbacks, so that their work is not optimized away.
+	thread_local std::uint64_t WorkSink = 0;
+
+	void VisitNodeWork(const Node& node)
+	{
+		thread_local std::vector<NodeArgument> args;
+		node.ReadArguments(args);
+		std::uint64_t hash = 14695981039346656037ull;
+		for (auto& arg : args)
+		{
+			if (arg.GetArgumentType() == NodeArgumentType::STR)
+			{
+				for (auto c : arg.GetString())
+				{
+					hash = (hash ^ static_cast<std::uint8_t>(c)) * 1099511628211ull;
+				}
+			}
+		}
+		WorkSink += hash;
+	}
+
+	//ParallelForEach on a tree where one top-level node holds almost all nodes, so that only
+	//splitting subtrees and stealing spread the work, at increasing thread counts.
+	void BenchmarkParallel(const BenchOptions& options)
+	{
+		auto file = GenerateDocument([&](SegmentBuilder& builder)
+			{
+				std::vector<std::uint32_t> names;
+				for (int i = 0; i < 100; ++i)
+				{
+					names.push_back(builder.AddString("a somewhat longer item name " + std::to_string(i)));
+				}
+				builder.WriteNode(TypeGroup, {}, { 0u });
+				for (std::uint32_t g = 0; g < 40 * options.Scale; ++g)
+				{
+					builder.WriteNode(TypeGroup, {}, { g });
+					for (std::uint32_t i = 0; i < 500; ++i)
+					{
+						builder.WriteNode(TypeItem, {}, { i, names[(g + i) % names.size()] });
+					}
+					builder.EndChildren();
+				}
+				builder.EndChildren();
+				for (std::uint32_t g = 0; g < 100; ++g)
+				{
+					builder.WriteNode(TypeGroup, {}, { g });
+					builder.WriteNode(TypeItem, {}, { g, names[g % names.size()] });
+					builder.EndChildren();
+				}
+			});
+		auto doc = Document::ReadFromData(nullptr, file.data(), static_cast<std::uint32_t>(file.size()));
+		const int iterations = 10;
+
+		std::function<void(NodeRange)> visit;
+		visit = [&](NodeRange range)
+		{
+			for (auto& node : range)
+			{
+				VisitNodeWork(node);
+				visit(node.GetChildren());
+			}
+		};
+		auto sequentialTime = Measure(iterations, [&]() { visit(doc->GetAllNodes()); });
+
+		std::cout << "parallel: " << CountNodes(doc->GetAllNodes()) << " nodes, skewed tree" << std::endl;
+		std::cout << "  sequential " << sequentialTime << " ms" << std::endl;
+		auto maxThreads = options.GetThreadCount();
+		WorkerPool pool(maxThreads);
+		for (std::uint32_t threads = 1; ; threads = std::min(threads * 2, maxThreads))
+		{
+			ParallelOptions parallelOptions;
+			parallelOptions.ThreadCount = threads;
+			auto time = Measure(iterations, [&]() { ParallelForEach(pool, doc->GetAllNodes(), VisitNodeWork, parallelOptions); });
+			std::cout << "  " << threads << " threads " << time << " ms (speedup " << sequentialTime / time << ")" << std::endl;
+			if (threads == maxThreads)
+			{
+				break;
+			}
+		}
+	}
+
+	//Size of the compressed data section at several block sizes, and the latency of reading
+	//strings and DAT payloads of nodes in random order, against the uncompressed document.
+	void BenchmarkCompression(const BenchOptions& options)
+	{
+		auto file = GenerateDocument([&](SegmentBuilder& builder)
+			{
+				std::uint32_t seed = 1;
+				std::string payload;
+				for (std::uint32_t g = 0; g < 100 * options.Scale; ++g)
+				{
+					builder.WriteNode(TypeGroup, {}, { g });
+					for (std::uint32_t i = 0; i < 10; ++i)
+					{
+						seed = seed * 1103515245 + 12345;
+						auto name = "item " + std::to_string(g) + "." + std::to_string(i) + " value " + std::to_string(seed >> 20);
+						builder.WriteNode(TypeItem, {}, { seed, builder.AddString(name) });
+					}
+					payload.clear();
+					for (std::uint32_t i = 0; i < 40; ++i)
+					{
+						seed = seed * 1103515245 + 12345;
+						payload += "record " + std::to_string(i) + " flags " + std::to_string(seed >> 28) + ";";
+					}
+					std::uint32_t begin = builder.AddData(payload.data(), static_cast<std::uint32_t>(payload.size()));
+					builder.WriteNode(TypeBlob, {}, { { begin, begin + static_cast<std::uint32_t>(payload.size()) } });
+					builder.EndChildren();
+				}
+			});
+		auto source = Document::ReadFromData(nullptr, file.data(), static_cast<std::uint32_t>(file.size()));
+		const int iterations = 5;
+
+		auto measureAccess = [&](const std::vector<std::uint8_t>& data, double* pLoad)
+		{
+			auto length = static_cast<std::uint32_t>(data.size());
+			*pLoad = Measure(iterations, [&]() { Document::ReadFromData(nullptr, data.data(), length); });
+			auto doc = Document::ReadFromData(nullptr, data.data(), length);
+			std::vector<Node> nodes;
+			for (auto& group : doc->GetAllNodes())
+			{
+				for (auto& node : group.GetChildren())
+				{
+					nodes.push_back(node);
+				}
+			}
+			//Visit the nodes in a fixed pseudo-random order so that most reads miss the block cache.
+			std::uint32_t seed = 7;
+			for (std::size_t i = nodes.size() - 1; i > 0; --i)
+			{
+				seed = seed * 1103515245 + 12345;
+				std::swap(nodes[i], nodes[(seed >> 8) % (i + 1)]);
+			}
+			std::vector<NodeArgument> args;
+			std::vector<std::uint8_t> bytes;
+			auto time = Measure(iterations, [&]()
+				{
+					for (auto& node : nodes)
+					{
+						node.ReadArguments(args);
+						if (args[0].GetArgumentType() == NodeArgumentType::DAT)
+						{
+							args[0].GetData(bytes);
+							WorkSink += bytes.size();
+						}
+						else
+						{
+							WorkSink += args[1].GetString().size();
+						}
+					}
+				});
+			return time * 1e6 / nodes.size();
+		};
+
+		auto raw = Repack(source.get()).Document;
+		double rawLoad;
+		auto rawAccess = measureAccess(raw, &rawLoad);
+		std::cout << "compression: " << raw.size() << " bytes uncompressed" << std::endl;
+		std::cout << "  uncompressed       load " << rawLoad << " ms, access " << rawAccess << " ns/node" << std::endl;
+		for (std::uint32_t blockSize : { 1024u, 4096u, 16384u, 65536u })
+		{
+			RepackOptions repackOptions;
+			repackOptions.CompressData = true;
+			repackOptions.CompressionBlockSize = blockSize;
+			auto compressed = Repack(source.get(), repackOptions).Document;
+			double load;
+			auto access = measureAccess(compressed, &load);
+			std::cout << "  block size " << std::setw(5) << blockSize << "   ratio "
+				<< static_cast<double>(compressed.size()) / raw.size() << ", load " << load << " ms, access "
+				<< access << " ns/node" << std::endl;
+		}
+	}
+
+	int PrintUsage()
+	{
+		std::cerr << "Usage: MapleCodeBench [benchmark...] [options]" << std::endl;
+		std::cerr << "Benchmarks (all if none is given):" << std::endl;
+		std::cerr << "  query       compiled query against a hand-written traversal" << std::endl;
+		std::cerr << "  load        multithreaded loading with the default allocator and with arenas" << std::endl;
+		std::cerr << "  parallel    ParallelForEach scaling on a skewed tree" << std::endl;
+		std::cerr << "  compression compressed size and access latency at several block sizes" << std::endl;
+		std::cerr << "Options:" << std::endl;
+		std::cerr << "  -s <scale>  multiply the size of the generated documents" << std::endl;
+		std::cerr << "  -t <count>  threads of the multithreaded benchmarks" << std::endl;
+		return 1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::pair<std::string, std::function<void(const BenchOptions&)>>> benchmarks = {
+		{ "query", BenchmarkQuery },
+		{ "load", BenchmarkLoad },
+		{ "parallel", BenchmarkParallel },
+		{ "compression", BenchmarkCompression },
+	};
+	std::vector<std::string> selected;
+	BenchOptions options;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (i + 1 < argc && arg == "-s")
+		{
+			options.Scale = static_cast<std::uint32_t>(std::atoi(argv[++i]));
+			if (options.Scale == 0)
+			{
+				return PrintUsage();
+			}
+		}
+		else if (i + 1 < argc && arg == "-t")
+		{
+			options.Threads = static_cast<std::uint32_t>(std::atoi(argv[++i]));
+		}
+		else if (arg[0] != '-')
+		{
+			selected.push_back(arg);
+		}
+		else
+		{
+			return PrintUsage();
+		}
+	}
+	for (auto& name : selected)
+	{
+		if (std::find_if(benchmarks.begin(), benchmarks.end(), [&](auto& b) { return b.first == name; }) == benchmarks.end())
+		{
+			return PrintUsage();
+		}
+	}
+
+	try
+	{
+		for (auto& benchmark : benchmarks)
+		{
+			if (selected.empty() || std::find(selected.begin(), selected.end(), benchmark.first) != selected.end())
+			{
+				benchmark.second(options);
+			}
+		}
+	}
+	catch (const ReaderException& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
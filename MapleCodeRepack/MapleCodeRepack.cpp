@@ -0,0 +1,126 @@
+#include "../MapleCode/MapleCodeRepack.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+using namespace MapleCode::Reader;
+
+static bool ReadFile(const char* path, std::vector<std::uint8_t>& result)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	result.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
+static bool WriteFile(const char* path, const std::vector<std::uint8_t>& data)
+{
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	return static_cast<bool>(file);
+}
+
+static int PrintUsage()
+{
+	std::cerr << "Usage: MapleCodeRepack <input> <output> [options]" << std::endl;
+	std::cerr << "  -t <file>   read the input with an external type list" << std::endl;
+	std::cerr << "  -x <file>   write the type table to a separate type list" << std::endl;
+	std::cerr << "  -w <width>  minimum width of the SizeMode fields (1, 2 or 4)" << std::endl;
+	std::cerr << "  -n          do not deduplicate data payloads" << std::endl;
+	std::cerr << "  -c          compress the data section" << std::endl;
+	std::cerr << "  -b <size>   block size of the compressed data section" << std::endl;
+	return 1;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		return PrintUsage();
+	}
+	const char* inputPath = argv[1];
+	const char* outputPath = argv[2];
+	const char* typeListPath = nullptr;
+	const char* typeListOutputPath = nullptr;
+	RepackOptions options;
+
+	for (int i = 3; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "-n")
+		{
+			options.DeduplicateData = false;
+		}
+		else if (arg == "-c")
+		{
+			options.CompressData = true;
+		}
+		else if (i + 1 < argc && arg == "-b")
+		{
+			options.CompressionBlockSize = static_cast<std::uint32_t>(std::atoi(argv[++i]));
+		}
+		else if (i + 1 < argc && arg == "-t")
+		{
+			typeListPath = argv[++i];
+		}
+		else if (i + 1 < argc && arg == "-x")
+		{
+			typeListOutputPath = argv[++i];
+			options.ExternalizeTypes = true;
+		}
+		else if (i + 1 < argc && arg == "-w")
+		{
+			options.MinimumWidth = static_cast<std::uint32_t>(std::atoi(argv[++i]));
+		}
+		else
+		{
+			return PrintUsage();
+		}
+	}
+
+	try
+	{
+		std::vector<std::uint8_t> typeListData, inputData;
+		std::unique_ptr<Document> typeList;
+		if (typeListPath != nullptr)
+		{
+			if (!ReadFile(typeListPath, typeListData))
+			{
+				std::cerr << "Cannot read " << typeListPath << std::endl;
+				return 1;
+			}
+			typeList = Document::ReadFromData(nullptr, typeListData.data(),
+				static_cast<std::uint32_t>(typeListData.size()));
+		}
+		if (!ReadFile(inputPath, inputData))
+		{
+			std::cerr << "Cannot read " << inputPath << std::endl;
+			return 1;
+		}
+		auto doc = Document::ReadFromData(typeList.get(), inputData.data(),
+			static_cast<std::uint32_t>(inputData.size()));
+
+		auto result = Repack(doc.get(), options);
+		if (!WriteFile(outputPath, result.Document))
+		{
+			std::cerr << "Cannot write " << outputPath << std::endl;
+			return 1;
+		}
+		if (typeListOutputPath != nullptr && !WriteFile(typeListOutputPath, result.TypeList))
+		{
+			std::cerr << "Cannot write " << typeListOutputPath << std::endl;
+			return 1;
+		}
+		std::cout << inputData.size() << " -> " << result.Document.size() << " bytes" << std::endl;
+	}
+	catch (const ReaderException& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
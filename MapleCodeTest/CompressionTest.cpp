@@ -0,0 +1,152 @@
+#include "pch.h"
+#include "TestFiles.h"
+#include "../MapleCode/MapleCodeCompression.h"
+#include "../MapleCode/MapleCodeHash.h"
+#include "../MapleCode/MapleCodeRepack.h"
+#include "../MapleCode/MapleCodeSegment.h"
+#include <atomic>
+#include <thread>
+
+using namespace MapleCode::Reader;
+using namespace MapleCodeTest::TestFiles;
+using namespace std::string_literals;
+
+namespace MapleCodeTest
+{
+	TEST_CLASS(CompressionTest)
+	{
+	public:
+		TEST_METHOD(CompressRoundTrip)
+		{
+			std::vector<std::uint8_t> data;
+			std::uint32_t seed = 1;
+			for (std::uint32_t i = 0; i < 5000; ++i)
+			{
+				seed = seed * 1103515245 + 12345;
+				data.push_back(i % 700 < 400 ? static_cast<std::uint8_t>(i % 13) : static_cast<std::uint8_t>(seed >> 16));
+			}
+
+			for (std::uint32_t blockSize : { 1u, 7u, 256u, 65536u })
+			{
+				auto payload = CompressedDataSection::Compress(data.data(), static_cast<std::uint32_t>(data.size()), blockSize);
+				CompressedDataSection section(payload.data(), static_cast<std::uint32_t>(payload.size()),
+					static_cast<std::uint32_t>(data.size()));
+				Assert::AreEqual(payload.size(), std::size_t{ section.GetPayloadLength() });
+				section.SetCacheCapacity(2);
+
+				std::vector<std::uint8_t> all(data.size());
+				section.Read(0, static_cast<std::uint32_t>(data.size()), all.data());
+				Assert::AreEqual(data, all);
+
+				std::vector<std::uint8_t> part(300);
+				section.Read(1000, 1300, part.data());
+				Assert::AreEqual(std::vector<std::uint8_t>(data.begin() + 1000, data.begin() + 1300), part);
+			}
+
+			auto payload = CompressedDataSection::Compress(data.data(), static_cast<std::uint32_t>(data.size()), 256);
+			Assert::IsTrue(payload.size() < data.size());
+			payload[payload.size() - 2] ^= 0xFF;
+			CompressedDataSection corrupted(payload.data(), static_cast<std::uint32_t>(payload.size()),
+				static_cast<std::uint32_t>(data.size()));
+			std::vector<std::uint8_t> last(100);
+			Assert::ExpectException<ReaderException>([&]() { corrupted.Read(4900, 5000, last.data()); });
+			Assert::ExpectException<ReaderException>([&]()
+				{
+					CompressedDataSection(payload.data(), 16, static_cast<std::uint32_t>(data.size()));
+				});
+		}
+
+		TEST_METHOD(ConcurrentCachedReads)
+		{
+			std::vector<std::uint8_t> data(20000);
+			for (std::uint32_t i = 0; i < data.size(); ++i)
+			{
+				data[i] = static_cast<std::uint8_t>((i * 7) % 251);
+			}
+			auto payload = CompressedDataSection::Compress(data.data(), static_cast<std::uint32_t>(data.size()), 512);
+
+			//Reads do not allocate, so an unsynchronized pool is enough.
+			std::pmr::unsynchronized_pool_resource resource;
+			CompressedDataSection section(payload.data(), static_cast<std::uint32_t>(payload.size()),
+				static_cast<std::uint32_t>(data.size()), &resource);
+			section.SetCacheCapacity(2);
+
+			std::atomic<int> mismatches{ 0 };
+			std::vector<std::thread> threads;
+			for (std::uint32_t t = 0; t < 4; ++t)
+			{
+				threads.emplace_back([&, t]()
+					{
+						std::vector<std::uint8_t> part(700);
+						for (std::uint32_t i = 0; i < 200; ++i)
+						{
+							auto begin = (i * 997 + t * 3001) % (static_cast<std::uint32_t>(data.size()) - 700);
+							section.Read(begin, begin + 700, part.data());
+							if (!std::equal(part.begin(), part.end(), data.begin() + begin))
+							{
+								++mismatches;
+							}
+						}
+					});
+			}
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+			Assert::AreEqual(0, mismatches.load());
+		}
+
+		TEST_METHOD(ReadCompressedDocument)
+		{
+			auto src = Document::ReadFromData(nullptr, SimpleNodes.data(), SimpleNodes.size());
+			RepackOptions options;
+			options.CompressData = true;
+			options.CompressionBlockSize = 4;
+			auto result = Repack(src.get(), options);
+			Assert::AreEqual(std::uint8_t{ 0 }, result.Document[0]);
+
+			auto doc = Document::ReadFromData(nullptr, result.Document.data(), result.Document.size());
+			Assert::IsTrue(doc->GetDocumentData()->CompressedData != nullptr);
+			doc->GetDocumentData()->CompressedData->SetCacheCapacity(1);
+			//Strings are not decompressed at load.
+			Assert::IsTrue(doc->GetDocumentData()->StrList.empty());
+			Assert::AreEqual(src->GetDocumentData()->GetStringCount(), doc->GetDocumentData()->GetStringCount());
+			Assert::ExpectException<ReaderException>([&]()
+				{
+					doc->GetDocumentData()->GetString(doc->GetDocumentData()->GetStringCount());
+				});
+
+			auto nodes = doc->GetAllNodes().ToList();
+			Assert::AreEqual(std::size_t{ 3 }, nodes.size());
+			Assert::AreEqual("node_b"s, nodes[1].GetNodeType()->GetName());
+			std::vector<NodeArgument> args;
+			nodes[1].ReadArguments(args);
+			Assert::AreEqual("string"s, args[1].GetString());
+
+			std::vector<std::string> generics;
+			nodes[2].ReadGenericArguments(generics);
+			Assert::AreEqual(std::vector<std::string>{ "t1", "t2" }, generics);
+			nodes[2].ReadArguments(args);
+			std::vector<std::uint8_t> data;
+			args[0].GetData(data);
+			Assert::AreEqual(std::vector<std::uint8_t>{ 0, 1, 2, 3, 4 }, data);
+
+			auto srcHashes = NodeHashTable::Compute(src.get());
+			auto hashes = NodeHashTable::Compute(doc.get());
+			auto srcNodes = src->GetAllNodes().ToList();
+			for (std::size_t i = 0; i < nodes.size(); ++i)
+			{
+				Assert::IsTrue(srcHashes.GetHash(srcNodes[i]) == hashes.GetHash(nodes[i]));
+			}
+
+			auto raw = Repack(doc.get());
+			Assert::AreEqual(Repack(src.get()).Document, raw.Document);
+
+			Assert::ExpectException<ReaderException>([&]() { SegmentBuilder builder(doc.get()); });
+			Assert::ExpectException<ReaderException>([&]()
+				{
+					Document::ReadFromSegmentedData(nullptr, result.Document.data(), result.Document.size());
+				});
+		}
+	};
+}
@@ -0,0 +1,46 @@
+#include "pch.h"
+#include "TestFiles.h"
+#include "../MapleCode/MapleCodeHash.h"
+
+using namespace MapleCode::Reader;
+using namespace MapleCodeTest::TestFiles;
+
+namespace MapleCodeTest
+{
+	TEST_CLASS(HashTest)
+	{
+	public:
+		TEST_METHOD(HashChildren)
+		{
+			auto doc = Document::ReadFromData(nullptr, Children.data(), Children.size());
+			auto hashes = NodeHashTable::Compute(doc.get());
+			Assert::AreEqual(std::size_t{ 6 }, hashes.GetCount());
+
+			auto n1 = doc->GetAllNodes().ToList()[0];
+			auto n1c = n1.GetChildren().ToList();
+			auto n12c = n1c[1].GetChildren().ToList();
+			auto n1211 = n12c[0].GetChildren().ToList()[0];
+
+			Assert::IsTrue(hashes.GetHash(n1c[0]) == hashes.GetHash(n12c[1]));
+			Assert::IsTrue(hashes.GetHash(n1c[0]) == hashes.GetHash(n1211));
+			Assert::IsTrue(hashes.GetHash(n1) != hashes.GetHash(n1c[1]));
+			Assert::IsTrue(hashes.GetHash(n1c[1]) != hashes.GetHash(n12c[0]));
+		}
+
+		TEST_METHOD(HashAcrossDocuments)
+		{
+			auto doc1 = Document::ReadFromData(nullptr, Reference.data(), Reference.size());
+			auto doc2 = Document::ReadFromData(nullptr, Reference.data(), Reference.size());
+			auto hashes1 = NodeHashTable::Compute(doc1.get());
+			auto hashes2 = NodeHashTable::Compute(doc2.get());
+
+			auto nodes1 = doc1->GetAllNodes().ToList();
+			auto nodes2 = doc2->GetAllNodes().ToList();
+			Assert::IsTrue(hashes1.GetHash(nodes1[0]) == hashes2.GetHash(nodes2[0]));
+			Assert::IsTrue(hashes1.GetHash(nodes1[1]) == hashes2.GetHash(nodes2[1]));
+			Assert::IsTrue(hashes1.GetHash(nodes1[0]) != hashes1.GetHash(nodes1[1]));
+
+			Assert::ExpectException<ReaderException>([&]() { hashes1.GetHash(nodes2[0]); });
+		}
+	};
+}
@@ -0,0 +1,126 @@
+#include "pch.h"
+#include "TestFiles.h"
+#include "../MapleCode/MapleCodeIndex.h"
+#include <cstdio>
+
+using namespace MapleCode::Reader;
+using namespace MapleCodeTest::TestFiles;
+
+namespace MapleCodeTest
+{
+	TEST_CLASS(IndexTest)
+	{
+	public:
+		TEST_METHOD(BuildAndAttach)
+		{
+			auto doc = Document::ReadFromData(nullptr, Children.data(), Children.size());
+			auto built = DocumentIndex::Build(doc.get());
+			Assert::IsTrue(built.IsValidated());
+			std::vector<std::uint8_t> sidecar(built.GetSidecarData(), built.GetSidecarData() + built.GetSidecarLength());
+
+			auto doc2 = Document::ReadFromData(nullptr, Children.data(), Children.size());
+			DocumentIndex index;
+			Assert::IsTrue(DocumentIndex::TryAttach(doc2.get(), sidecar.data(), sidecar.size(), &index));
+			Assert::AreEqual(6u, index.GetNodeCount());
+
+			auto n1 = doc2->GetAllNodes().ToList()[0];
+			auto n1c = n1.GetChildren().ToList();
+			auto n12c = n1c[1].GetChildren().ToList();
+			auto n1211 = n12c[0].GetChildren().ToList()[0];
+			Assert::IsTrue(index.GetParent(n1).IsNull());
+			Assert::AreEqual(n1, index.GetParent(n1c[1]));
+			Assert::AreEqual(n12c[0], index.GetParent(n1211));
+			Assert::AreEqual(n1c[1], index.GetParent(n12c[1]));
+
+			std::vector<Node> nodes;
+			index.GetNodesOfType(1, nodes);
+			Assert::AreEqual(std::vector<Node>{ n1c[0], n1211, n12c[1] }, nodes);
+
+			auto other = Document::ReadFromData(nullptr, Reference.data(), Reference.size());
+			Assert::IsFalse(DocumentIndex::TryAttach(other.get(), sidecar.data(), sidecar.size(), &index));
+		}
+
+		TEST_METHOD(ReferenceBackLinks)
+		{
+			auto doc = Document::ReadFromData(nullptr, Reference.data(), Reference.size());
+			auto index = DocumentIndex::Build(doc.get());
+			auto nodes = doc->GetAllNodes().ToList();
+
+			std::vector<Node> refs;
+			index.GetReferencesTo(nodes[0], refs);
+			Assert::AreEqual(std::vector<Node>{ nodes[0], nodes[1] }, refs);
+			index.GetReferencesTo(nodes[1], refs);
+			Assert::AreEqual(std::vector<Node>{ nodes[0], nodes[1] }, refs);
+		}
+
+		TEST_METHOD(LoadOrBuildSidecarFile)
+		{
+			const char* path = "Reference.index.tmp";
+			std::remove(path);
+			auto doc = Document::ReadFromData(nullptr, Reference.data(), Reference.size());
+			auto built = DocumentIndex::LoadOrBuild(doc.get(), path);
+			Assert::AreNotEqual(std::size_t{ 0 }, built.GetSidecarLength());
+
+			auto loaded = DocumentIndex::LoadOrBuild(doc.get(), path);
+			Assert::AreEqual(built.GetSidecarLength(), loaded.GetSidecarLength());
+			Assert::AreEqual(0, std::memcmp(built.GetSidecarData(), loaded.GetSidecarData(), built.GetSidecarLength()));
+			Assert::AreEqual(2u, loaded.GetNodeCount());
+
+			auto other = Document::ReadFromData(nullptr, Children.data(), Children.size());
+			auto rebuilt = DocumentIndex::LoadOrBuild(other.get(), path);
+			Assert::AreEqual(6u, rebuilt.GetNodeCount());
+			Assert::AreEqual(6u, DocumentIndex::LoadOrBuild(other.get(), path).GetNodeCount());
+			std::remove(path);
+		}
+
+		TEST_METHOD(LoadOrBuildWithSidecarInUse)
+		{
+			const char* path = "Shared.index.tmp";
+			std::remove(path);
+			auto doc = Document::ReadFromData(nullptr, Reference.data(), Reference.size());
+			DocumentIndex::LoadOrBuild(doc.get(), path);
+			auto mapped = DocumentIndex::LoadOrBuild(doc.get(), path);
+
+			//The old sidecar is still mapped by the first index while it is replaced.
+			auto other = Document::ReadFromData(nullptr, Children.data(), Children.size());
+			auto rebuilt = DocumentIndex::LoadOrBuild(other.get(), path);
+			Assert::AreEqual(6u, rebuilt.GetNodeCount());
+			auto n1 = other->GetAllNodes().ToList()[0];
+			Assert::AreEqual(n1, rebuilt.GetParent(n1.GetChildren().ToList()[1]));
+
+			auto nodes = doc->GetAllNodes().ToList();
+			std::vector<Node> refs;
+			mapped.GetReferencesTo(nodes[0], refs);
+			Assert::AreEqual(std::vector<Node>{ nodes[0], nodes[1] }, refs);
+			std::remove(path);
+
+			//A sidecar that cannot be written still gives an index.
+			auto unwritten = DocumentIndex::LoadOrBuild(other.get(), "missing-directory/Children.index.tmp");
+			Assert::AreEqual(6u, unwritten.GetNodeCount());
+		}
+
+		TEST_METHOD(VerifyContentOnAttach)
+		{
+			const char* path = "Children.index.tmp";
+			std::remove(path);
+			auto doc = Document::ReadFromData(nullptr, Children.data(), Children.size());
+			auto built = DocumentIndex::Build(doc.get());
+			DocumentIndex::LoadOrBuild(doc.get(), path);
+
+			//Same layout and tables, renamed type in the data section.
+			auto changed = Children;
+			changed[37] = 'c';
+			auto doc2 = Document::ReadFromData(nullptr, changed.data(), changed.size());
+			DocumentIndex index;
+			Assert::IsFalse(DocumentIndex::TryAttach(doc2.get(), built.GetSidecarData(), built.GetSidecarLength(), &index));
+			Assert::IsTrue(DocumentIndex::TryAttach(doc.get(), built.GetSidecarData(), built.GetSidecarLength(), &index));
+
+			//The stale sidecar is rebuilt for the changed document.
+			auto rebuilt = DocumentIndex::LoadOrBuild(doc2.get(), path);
+			Assert::AreEqual(6u, rebuilt.GetNodeCount());
+			Assert::AreNotEqual(0, std::memcmp(built.GetSidecarData(), rebuilt.GetSidecarData(), built.GetSidecarLength()));
+			Assert::IsTrue(DocumentIndex::TryAttach(doc2.get(), rebuilt.GetSidecarData(), rebuilt.GetSidecarLength(), &index));
+			std::remove(path);
+		}
+	};
+}
@@ -0,0 +1,157 @@
+#include "pch.h"
+#include "TestFiles.h"
+#include "../MapleCode/MapleCodeCompression.h"
+#include "../MapleCode/MapleCodeHash.h"
+#include "../MapleCode/MapleCodeIndex.h"
+#include "../MapleCode/MapleCodeQuery.h"
+#include "../MapleCode/MapleCodeRepack.h"
+#include "../MapleCode/MapleCodeSegment.h"
+
+using namespace MapleCode::Reader;
+using namespace MapleCodeTest::TestFiles;
+using namespace std::string_literals;
+
+namespace MapleCodeTest
+{
+	//Forwards to an upstream resource and counts live allocations.
+	class CountingResource : public std::pmr::memory_resource
+	{
+	public:
+		std::pmr::memory_resource* Upstream;
+		std::size_t Allocations = 0, Live = 0;
+
+		CountingResource(std::pmr::memory_resource* upstream) : Upstream(upstream) {}
+
+	private:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			++Allocations;
+			++Live;
+			return Upstream->allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+		{
+			--Live;
+			Upstream->deallocate(p, bytes, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+	};
+
+	//Makes any allocation from the default resource throw while in scope.
+	struct NoDefaultResource
+	{
+		std::pmr::memory_resource* Previous;
+
+		NoDefaultResource() : Previous(std::pmr::set_default_resource(std::pmr::null_memory_resource())) {}
+		~NoDefaultResource() { std::pmr::set_default_resource(Previous); }
+	};
+
+	TEST_CLASS(MemoryResourceTest)
+	{
+	public:
+		TEST_METHOD(ReadIntoResource)
+		{
+			CountingResource counter(std::pmr::new_delete_resource());
+			{
+				PmrDocumentPtr doc;
+				{
+					NoDefaultResource guard;
+					doc = Document::ReadFromData(nullptr, SimpleNodes.data(), SimpleNodes.size(), &counter);
+				}
+				Assert::AreNotEqual(std::size_t{ 0 }, counter.Allocations);
+				Assert::IsTrue(doc->GetDocumentData()->Resource == &counter);
+
+				auto nodes = doc->GetAllNodes().ToList();
+				Assert::AreEqual(std::size_t{ 3 }, nodes.size());
+				Assert::AreEqual("node_b"s, nodes[1].GetNodeType()->GetName());
+				std::vector<NodeArgument> args;
+				nodes[1].ReadArguments(args);
+				Assert::AreEqual("string"s, args[1].GetString());
+
+				auto before = counter.Allocations;
+				auto hashes = NodeHashTable::Compute(doc.get());
+				Assert::AreEqual(std::size_t{ 3 }, hashes.GetCount());
+				Assert::IsTrue(counter.Allocations > before);
+			}
+			Assert::AreEqual(std::size_t{ 0 }, counter.Live);
+		}
+
+		TEST_METHOD(AuxiliaryStructuresInResource)
+		{
+			CountingResource counter(std::pmr::new_delete_resource());
+			{
+				auto doc = Document::ReadFromData(nullptr, Reference.data(), Reference.size(), &counter);
+				auto before = counter.Allocations;
+				auto index = DocumentIndex::Build(doc.get());
+				Assert::IsTrue(counter.Allocations > before);
+				Assert::AreEqual(2u, index.GetNodeCount());
+
+				before = counter.Allocations;
+				auto query = NodeQuery::Compile(doc.get(), "//*");
+				Assert::IsTrue(counter.Allocations > before);
+				Assert::AreEqual(std::size_t{ 2 }, query.Select().size());
+
+				before = counter.Allocations;
+				SegmentBuilder builder(doc.get());
+				builder.WriteNode(0, {}, { 0u, { 0u, builder.AddString("z") } });
+				Assert::IsTrue(counter.Allocations > before);
+			}
+			Assert::AreEqual(std::size_t{ 0 }, counter.Live);
+		}
+
+		TEST_METHOD(ReadExternalTypesIntoArena)
+		{
+			auto src = Document::ReadFromData(nullptr, Children.data(), Children.size());
+			RepackOptions options;
+			options.ExternalizeTypes = true;
+			auto result = Repack(src.get(), options);
+			auto types = Document::ReadFromData(nullptr, result.TypeList.data(), result.TypeList.size());
+
+			std::pmr::monotonic_buffer_resource arena;
+			NoDefaultResource guard;
+			auto doc = Document::ReadFromData(types.get(), result.Document.data(), result.Document.size(), &arena);
+			auto segmented = Document::ReadFromSegmentedData(nullptr, Children.data(), Children.size(), &arena);
+			auto nodes = doc->GetAllNodes().ToList();
+			Assert::AreEqual(std::size_t{ 1 }, nodes.size());
+			Assert::AreEqual("node_a"s, nodes[0].GetNodeType()->GetName());
+			Assert::AreEqual(std::size_t{ 1 }, segmented->GetAllNodes().ToList().size());
+		}
+
+		TEST_METHOD(CompressedCacheInArena)
+		{
+			auto src = Document::ReadFromData(nullptr, SimpleNodes.data(), SimpleNodes.size());
+			RepackOptions options;
+			options.CompressData = true;
+			options.CompressionBlockSize = 4;
+			auto result = Repack(src.get(), options);
+
+			CountingResource counter(std::pmr::new_delete_resource());
+			std::pmr::monotonic_buffer_resource arena(&counter);
+			auto doc = Document::ReadFromData(nullptr, result.Document.data(), result.Document.size(), &arena);
+			auto data = doc->GetDocumentData();
+			data->CompressedData->SetCacheCapacity(2);
+			auto nodes = doc->GetAllNodes().ToList();
+
+			//Every read below misses the cache, which must reuse its blocks rather than grow the arena.
+			auto before = counter.Allocations;
+			std::vector<NodeArgument> args;
+			std::vector<std::uint8_t> payload;
+			for (int i = 0; i < 1000; ++i)
+			{
+				for (std::uint32_t s = 0; s < data->GetStringCount(); ++s)
+				{
+					data->GetString(s);
+				}
+				nodes[2].ReadArguments(args);
+				args[0].GetData(payload);
+			}
+			Assert::AreEqual(std::vector<std::uint8_t>{ 0, 1, 2, 3, 4 }, payload);
+			Assert::AreEqual(before, counter.Allocations);
+		}
+	};
+}
@@ -0,0 +1,113 @@
+#include "pch.h"
+#include "TestFiles.h"
+#include "../MapleCode/MapleCodeParallel.h"
+#include <algorithm>
+#include <mutex>
+
+using namespace MapleCode::Reader;
+using namespace MapleCodeTest::TestFiles;
+
+namespace MapleCodeTest
+{
+	static void CollectAll(NodeRange range, std::vector<std::uint32_t>& results)
+	{
+		for (auto& node : range)
+		{
+			results.push_back(node.GetOffset());
+			CollectAll(node.GetChildren(), results);
+		}
+	}
+
+	static std::vector<std::uint32_t> CollectParallel(NodeRange range, const ParallelOptions& options)
+	{
+		std::mutex lock;
+		std::vector<std::uint32_t> results;
+		ParallelForEach(range, [&](const Node& node)
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				results.push_back(node.GetOffset());
+			}, options);
+		std::sort(results.begin(), results.end());
+		return results;
+	}
+
+	TEST_CLASS(ParallelTest)
+	{
+	public:
+		TEST_METHOD(ParallelVisitAll)
+		{
+			auto doc = Document::ReadFromData(nullptr, Children.data(), Children.size());
+			std::vector<std::uint32_t> expected;
+			CollectAll(doc->GetAllNodes(), expected);
+			std::sort(expected.begin(), expected.end());
+			Assert::AreEqual(std::size_t{ 6 }, expected.size());
+
+			for (std::uint32_t grain : { 0u, 1u, 4u, 16384u })
+			{
+				ParallelOptions options;
+				options.ThreadCount = 4;
+				options.GrainSize = grain;
+				Assert::IsTrue(expected == CollectParallel(doc->GetAllNodes(), options));
+			}
+		}
+
+		TEST_METHOD(ParallelVisitTopLevel)
+		{
+			auto doc = Document::ReadFromData(nullptr, SimpleNodes.data(), SimpleNodes.size());
+			std::vector<std::uint32_t> expected;
+			for (auto& node : doc->GetAllNodes())
+			{
+				expected.push_back(node.GetOffset());
+			}
+
+			ParallelOptions options;
+			options.ThreadCount = 3;
+			options.GrainSize = 1;
+			options.Recursive = false;
+			Assert::IsTrue(expected == CollectParallel(doc->GetAllNodes(), options));
+
+			auto children = Document::ReadFromData(nullptr, Children.data(), Children.size());
+			Assert::AreEqual(std::size_t{ 1 }, CollectParallel(children->GetAllNodes(), options).size());
+		}
+
+		TEST_METHOD(ParallelReusePool)
+		{
+			auto doc = Document::ReadFromData(nullptr, Children.data(), Children.size());
+			std::vector<std::uint32_t> expected;
+			CollectAll(doc->GetAllNodes(), expected);
+			std::sort(expected.begin(), expected.end());
+
+			WorkerPool pool(4);
+			Assert::AreEqual(std::size_t{ 4 }, pool.GetThreadCount());
+			ParallelOptions options;
+			options.GrainSize = 1;
+			for (int i = 0; i < 20; ++i)
+			{
+				std::mutex lock;
+				std::vector<std::uint32_t> results;
+				ParallelForEach(pool, doc->GetAllNodes(), [&](const Node& node)
+					{
+						//A nested call on the same pool runs inline instead of waiting for the pool.
+						std::size_t nested = 0;
+						ParallelForEach(pool, node.GetChildren(), [&](const Node&) { ++nested; }, options);
+						std::lock_guard<std::mutex> guard(lock);
+						results.push_back(node.GetOffset());
+					}, options);
+				std::sort(results.begin(), results.end());
+				Assert::IsTrue(expected == results);
+			}
+		}
+
+		TEST_METHOD(ParallelException)
+		{
+			auto doc = Document::ReadFromData(nullptr, Children.data(), Children.size());
+			ParallelOptions options;
+			options.ThreadCount = 4;
+			options.GrainSize = 1;
+			Assert::ExpectException<ReaderException>([&]()
+				{
+					ParallelForEach(doc->GetAllNodes(), [](const Node&) { throw ReaderException("Test"); }, options);
+				});
+		}
+	};
+}
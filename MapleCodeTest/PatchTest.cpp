@@ -0,0 +1,75 @@
+#include "pch.h"
+#include "TestFiles.h"
+#include <algorithm>
+
+using namespace MapleCode::Reader;
+using namespace MapleCodeTest::TestFiles;
+using namespace std::string_literals;
+
+namespace MapleCodeTest
+{
+	TEST_CLASS(PatchTest)
+	{
+	public:
+		TEST_METHOD(PatchNumbers)
+		{
+			auto buffer = SimpleNodes;
+			auto doc = Document::ReadFromWritableData(nullptr, buffer.data(), buffer.size());
+			auto nodes = doc->GetAllNodes().ToList();
+
+			std::vector<NodeArgument> args;
+			nodes[0].ReadArguments(args);
+			Assert::IsTrue(args[0].SetUnsigned(123456));
+			Assert::AreEqual(123456u, args[0].GetUnsigned());
+
+			nodes[1].ReadArguments(args);
+			Assert::IsTrue(args[0].SetSigned(-100));
+			Assert::IsFalse(args[0].SetSigned(-200));
+			Assert::AreEqual(-100, args[0].GetSigned());
+			Assert::IsTrue(args[2].SetFloat(2.5f));
+			Assert::ExpectException<ReaderException>([&]() { args[0].SetUnsigned(1); });
+
+			auto reread = Document::ReadFromData(nullptr, buffer.data(), buffer.size());
+			auto rereadNodes = reread->GetAllNodes().ToList();
+			rereadNodes[0].ReadArguments(args);
+			Assert::AreEqual(123456u, args[0].GetUnsigned());
+			rereadNodes[1].ReadArguments(args);
+			Assert::AreEqual(-100, args[0].GetSigned());
+			Assert::AreEqual(2.5f, args[2].GetFloat());
+		}
+
+		TEST_METHOD(PatchStringAndReference)
+		{
+			auto buffer = Reference;
+			auto doc = Document::ReadFromWritableData(nullptr, buffer.data(), buffer.size());
+			auto nodes = doc->GetAllNodes().ToList();
+			auto& strings = doc->GetDocumentData()->StrList;
+			auto y = static_cast<std::uint32_t>(std::find(strings.begin(), strings.end(), "y") - strings.begin());
+
+			std::vector<NodeArgument> args;
+			nodes[0].ReadArguments(args);
+			Assert::IsTrue(args[0].SetNode(nodes[1]));
+			Assert::IsTrue(args[1].SetField(nodes[0], y));
+			Assert::AreEqual(nodes[1], args[0].GetNode());
+			Assert::AreEqual(nodes[0], std::get<0>(args[1].GetField()));
+			Assert::AreEqual("y"s, std::get<1>(args[1].GetField()));
+			Assert::ExpectException<ReaderException>([&]() { args[1].SetField(nodes[0], 1000); });
+
+			//Offset 2 decodes as a node of type 0 but lies inside the first node.
+			Node inside(doc->GetDocumentData(), nodes[0].GetOffset() + 2);
+			Assert::ExpectException<ReaderException>([&]() { args[0].SetNode(inside); });
+			Assert::ExpectException<ReaderException>([&]() { args[1].SetField(inside, y); });
+			auto other = Document::ReadFromData(nullptr, Reference.data(), Reference.size());
+			Assert::ExpectException<ReaderException>([&]() { args[0].SetNode(other->GetAllNodes().ToList()[0]); });
+			Assert::AreEqual(nodes[1], args[0].GetNode());
+		}
+
+		TEST_METHOD(PatchReadOnly)
+		{
+			auto doc = Document::ReadFromData(nullptr, SimpleNodes.data(), SimpleNodes.size());
+			std::vector<NodeArgument> args;
+			doc->GetAllNodes().ToList()[0].ReadArguments(args);
+			Assert::ExpectException<ReaderException>([&]() { args[0].SetUnsigned(1); });
+		}
+	};
+}
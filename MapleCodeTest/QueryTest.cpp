@@ -0,0 +1,60 @@
+#include "pch.h"
+#include "TestFiles.h"
+#include "../MapleCode/MapleCodeQuery.h"
+
+using namespace MapleCode::Reader;
+using namespace MapleCodeTest::TestFiles;
+
+namespace MapleCodeTest
+{
+	TEST_CLASS(QueryTest)
+	{
+	public:
+		TEST_METHOD(QueryArguments)
+		{
+			auto doc = Document::ReadFromData(nullptr, SimpleNodes.data(), SimpleNodes.size());
+			auto nodes = doc->GetAllNodes().ToList();
+			auto count = [&](const char* query)
+			{
+				return NodeQuery::Compile(doc.get(), query).Select().size();
+			};
+
+			Assert::AreEqual(nodes, NodeQuery::Compile(doc.get(), "//*").Select());
+			Assert::AreEqual(std::size_t{ 1 }, count("/node_a[0=10]"));
+			Assert::AreEqual(std::size_t{ 0 }, count("/node_a[0=11]"));
+			Assert::AreEqual(std::size_t{ 1 }, count("//node_b[0=-1][1=\"string\"]"));
+			Assert::AreEqual(std::size_t{ 0 }, count("//node_b[1=\"t1\"]"));
+			Assert::AreEqual(std::size_t{ 0 }, count("//node_b[1=\"missing\"]"));
+			Assert::AreEqual(std::size_t{ 1 }, count("//node_b[2=0.1]"));
+			Assert::AreEqual(std::size_t{ 1 }, count("//node_c<t1, t2>"));
+			Assert::AreEqual(std::size_t{ 1 }, count("//node_c<*, t2>"));
+			Assert::AreEqual(std::size_t{ 0 }, count("//node_c<t2, t1>"));
+			Assert::AreEqual(std::size_t{ 0 }, count("//node_c<t1>"));
+			Assert::AreEqual(std::size_t{ 0 }, count("//node_d"));
+
+			Assert::ExpectException<ReaderException>([&]() { count("node_a"); });
+			Assert::ExpectException<ReaderException>([&]() { count("//node_a[0=1"); });
+			Assert::ExpectException<ReaderException>([&]() { count("//node_a[0=\"x]"); });
+		}
+
+		TEST_METHOD(QueryChildren)
+		{
+			auto doc = Document::ReadFromData(nullptr, Children.data(), Children.size());
+			auto n1 = doc->GetAllNodes().ToList()[0];
+			auto n1c = n1.GetChildren().ToList();
+			auto n12c = n1c[1].GetChildren().ToList();
+			auto n1211 = n12c[0].GetChildren().ToList()[0];
+
+			auto select = [&](const char* query)
+			{
+				return NodeQuery::Compile(doc.get(), query).Select();
+			};
+			Assert::AreEqual(std::vector<Node>{ n1c[0], n1211, n12c[1] }, select("//node_b"));
+			Assert::AreEqual(std::vector<Node>{ n1c[0] }, select("/node_a/node_b"));
+			Assert::AreEqual(std::vector<Node>{ n1211, n12c[1] }, select("/node_a/node_a//node_b"));
+			Assert::AreEqual(std::vector<Node>{ n1211, n12c[1] }, select("//node_a/node_a/node_b"));
+			Assert::AreEqual(std::vector<Node>{ n1c[1], n12c[0] }, select("//node_a//node_a"));
+			Assert::AreEqual(std::vector<Node>{}, select("/node_b"));
+		}
+	};
+}
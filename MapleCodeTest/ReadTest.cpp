@@ -108,5 +108,53 @@ namespace MapleCodeTest
 			Assert::AreEqual(n2, std::get<0>(n2c[1].GetField()));
 			Assert::AreEqual(std::string("y"), std::get<1>(n2c[1].GetField()));
 		}
+
+		TEST_METHOD(ReadIndexOutOfRange)
+		{
+			//Each index below equals the size of its table, one past the last valid entry.
+			auto typeName = SimpleNodes;
+			typeName[11] = 0x06;
+			Assert::ExpectException<ReaderException>([&]()
+				{
+					Document::ReadFromData(nullptr, typeName.data(), typeName.size());
+				});
+
+			auto nodeType = SimpleNodes;
+			nodeType[28] = 0x03;
+			Assert::ExpectException<ReaderException>([&]()
+				{
+					auto doc = Document::ReadFromData(nullptr, nodeType.data(), nodeType.size());
+					doc->GetAllNodes().ToList();
+				});
+
+			auto stringArg = SimpleNodes;
+			stringArg[30] = 0x06;
+			Assert::ExpectException<ReaderException>([&]()
+				{
+					auto doc = Document::ReadFromData(nullptr, stringArg.data(), stringArg.size());
+					std::vector<NodeArgument> args;
+					doc->GetAllNodes().ToList()[1].ReadArguments(args);
+					args[1].GetString();
+				});
+
+			auto genericArg = SimpleNodes;
+			genericArg[36] = 0x06;
+			Assert::ExpectException<ReaderException>([&]()
+				{
+					auto doc = Document::ReadFromData(nullptr, genericArg.data(), genericArg.size());
+					std::vector<std::string> generics;
+					doc->GetAllNodes().ToList()[2].ReadGenericArguments(generics);
+				});
+
+			auto fieldName = Reference;
+			fieldName[15] = 0x03;
+			Assert::ExpectException<ReaderException>([&]()
+				{
+					auto doc = Document::ReadFromData(nullptr, fieldName.data(), fieldName.size());
+					std::vector<NodeArgument> args;
+					doc->GetAllNodes().ToList()[0].ReadArguments(args);
+					args[1].GetField();
+				});
+		}
 	};
 }
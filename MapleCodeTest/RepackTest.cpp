@@ -0,0 +1,132 @@
+#include "pch.h"
+#include "TestFiles.h"
+#include "../MapleCode/MapleCodeRepack.h"
+
+using namespace MapleCode::Reader;
+using namespace MapleCodeTest::TestFiles;
+using namespace std::string_literals;
+
+namespace MapleCodeTest
+{
+	TEST_CLASS(RepackTest)
+	{
+	public:
+		TEST_METHOD(RepackSimpleNodes)
+		{
+			auto src = Document::ReadFromData(nullptr, SimpleNodes.data(), SimpleNodes.size());
+			auto result = Repack(src.get());
+			Assert::IsTrue(result.Document.size() <= SimpleNodes.size());
+			Assert::AreEqual(std::size_t{ 0 }, result.TypeList.size());
+
+			auto doc = Document::ReadFromData(nullptr, result.Document.data(), result.Document.size());
+			auto nodes = doc->GetAllNodes().ToList();
+			Assert::AreEqual(std::size_t{ 3 }, nodes.size());
+
+			std::vector<NodeArgument> args;
+			nodes[1].ReadArguments(args);
+			Assert::AreEqual("node_b"s, nodes[1].GetNodeType()->GetName());
+			Assert::AreEqual(-1, args[0].GetSigned());
+			Assert::AreEqual("string"s, args[1].GetString());
+			Assert::AreEqual(0.1f, args[2].GetFloat());
+
+			std::vector<std::string> generics;
+			nodes[2].ReadGenericArguments(generics);
+			Assert::AreEqual(std::vector<std::string>{ "t1", "t2" }, generics);
+			nodes[2].ReadArguments(args);
+			std::vector<std::uint8_t> data;
+			args[0].GetData(data);
+			Assert::AreEqual(std::vector<std::uint8_t> { 0, 1, 2, 3, 4 }, data);
+		}
+
+		TEST_METHOD(RepackExternalTypes)
+		{
+			auto src = Document::ReadFromData(nullptr, Reference.data(), Reference.size());
+			RepackOptions options;
+			options.ExternalizeTypes = true;
+			options.MinimumWidth = 4;
+			auto result = Repack(src.get(), options);
+
+			auto types = Document::ReadFromData(nullptr, result.TypeList.data(), result.TypeList.size());
+			auto doc = Document::ReadFromData(types.get(), result.Document.data(), result.Document.size());
+			auto nodes = doc->GetAllNodes().ToList();
+			Assert::AreEqual(std::size_t{ 2 }, nodes.size());
+
+			std::vector<NodeArgument> n1c, n2c;
+			nodes[0].ReadArguments(n1c);
+			nodes[1].ReadArguments(n2c);
+			Assert::AreEqual(nodes[0], n1c[0].GetNode());
+			Assert::AreEqual(nodes[1], std::get<0>(n1c[1].GetField()));
+			Assert::AreEqual("x"s, std::get<1>(n1c[1].GetField()));
+			Assert::AreEqual(nodes[0], n2c[0].GetNode());
+			Assert::AreEqual("y"s, std::get<1>(n2c[1].GetField()));
+		}
+
+		TEST_METHOD(RepackChildren)
+		{
+			auto src = Document::ReadFromData(nullptr, Children.data(), Children.size());
+			RepackOptions options;
+			options.MinimumWidth = 2;
+			auto result = Repack(src.get(), options);
+			auto doc = Document::ReadFromData(nullptr, result.Document.data(), result.Document.size());
+
+			auto n1 = doc->GetAllNodes().ToList()[0];
+			auto n1c = n1.GetChildren().ToList();
+			Assert::AreEqual(std::size_t{ 2 }, n1c.size());
+			auto n12c = n1c[1].GetChildren().ToList();
+			Assert::AreEqual(std::size_t{ 2 }, n12c.size());
+			Assert::AreEqual("node_b"s, n12c[1].GetNodeType()->GetName());
+			Assert::AreEqual(n1c[1], n12c[1].FindParent());
+		}
+
+		TEST_METHOD(RepackRemovesUnusedEntries)
+		{
+			auto src = Document::ReadFromData(nullptr, UnusedEntries.data(), UnusedEntries.size());
+			Assert::AreEqual(std::size_t{ 4 }, src->GetDocumentData()->StrList.size());
+			Assert::AreEqual(std::size_t{ 2 }, src->GetDocumentData()->TypeList.size());
+			Assert::AreEqual(40u, src->GetDocumentData()->DataRange.GetLength());
+
+			auto result = Repack(src.get());
+			Assert::AreEqual(std::uint8_t{ 0x55 }, result.Document[0]);
+			auto doc = Document::ReadFromData(nullptr, result.Document.data(), result.Document.size());
+			auto data = doc->GetDocumentData();
+			Assert::AreEqual(std::size_t{ 2 }, data->StrList.size());
+			Assert::AreEqual(std::size_t{ 1 }, data->TypeList.size());
+			//"used", "type_a", the argument list and one copy of the payload.
+			Assert::AreEqual(5u + 7u + 4u + 4u, data->DataRange.GetLength());
+
+			auto nodes = doc->GetAllNodes().ToList();
+			Assert::AreEqual(std::size_t{ 1 }, nodes.size());
+			std::vector<NodeArgument> args;
+			nodes[0].ReadArguments(args);
+			Assert::AreEqual("used"s, args[0].GetString());
+			std::vector<std::uint8_t> payload;
+			args[1].GetData(payload);
+			Assert::AreEqual(std::vector<std::uint8_t>{ 1, 2, 3, 4 }, payload);
+			args[2].GetData(payload);
+			Assert::AreEqual(std::vector<std::uint8_t>{ 1, 2, 3, 4 }, payload);
+
+			RepackOptions options;
+			options.DeduplicateData = false;
+			auto copies = Repack(src.get(), options);
+			doc = Document::ReadFromData(nullptr, copies.Document.data(), copies.Document.size());
+			Assert::AreEqual(5u + 7u + 4u + 4u + 4u, doc->GetDocumentData()->DataRange.GetLength());
+		}
+
+		TEST_METHOD(RepackNarrowsSizeMode)
+		{
+			auto src = Document::ReadFromData(nullptr, UnusedEntries.data(), UnusedEntries.size());
+			RepackOptions options;
+			options.MinimumWidth = 4;
+			auto wide = Repack(src.get(), options);
+			Assert::AreEqual(std::uint8_t{ 0xFF }, wide.Document[0]);
+
+			auto doc = Document::ReadFromData(nullptr, wide.Document.data(), wide.Document.size());
+			auto narrow = Repack(doc.get());
+			Assert::AreEqual(std::uint8_t{ 0x55 }, narrow.Document[0]);
+			Assert::AreEqual(Repack(src.get()).Document, narrow.Document);
+
+			options.MinimumWidth = 2;
+			Assert::AreEqual(std::uint8_t{ 0xAA }, Repack(doc.get(), options).Document[0]);
+		}
+	};
+}
@@ -0,0 +1,115 @@
+#include "pch.h"
+#include "TestFiles.h"
+#include "../MapleCode/MapleCodeRepack.h"
+#include "../MapleCode/MapleCodeSegment.h"
+
+using namespace MapleCode::Reader;
+using namespace MapleCodeTest::TestFiles;
+using namespace std::string_literals;
+
+namespace MapleCodeTest
+{
+	TEST_CLASS(SegmentTest)
+	{
+	public:
+		TEST_METHOD(AppendReferenceSegments)
+		{
+			RepackOptions options;
+			options.MinimumWidth = 4;
+			auto src = Document::ReadFromData(nullptr, Reference.data(), Reference.size());
+			auto file = Repack(src.get(), options).Document;
+
+			auto doc = Document::ReadFromSegmentedData(nullptr, file.data(), file.size());
+			auto nodes = doc->GetAllNodes().ToList();
+			std::uint32_t n3;
+			{
+				SegmentBuilder builder(doc.get());
+				auto z = builder.AddString("z");
+				n3 = builder.WriteNode(0, {}, { nodes[1].GetOffset(), { nodes[0].GetOffset(), z } });
+				auto segment = builder.Finish();
+				file.insert(file.end(), segment.begin(), segment.end());
+			}
+
+			doc = Document::ReadFromSegmentedData(nullptr, file.data(), file.size());
+			{
+				SegmentBuilder builder(doc.get());
+				auto x = builder.AddString("x");
+				builder.WriteNode(0, {}, { n3, { n3, x } });
+				auto segment = builder.Finish();
+				file.insert(file.end(), segment.begin(), segment.end());
+			}
+
+			doc = Document::ReadFromSegmentedData(nullptr, file.data(), file.size());
+			nodes = doc->GetAllNodes().ToList();
+			Assert::AreEqual(std::size_t{ 4 }, nodes.size());
+			std::vector<NodeArgument> args;
+			nodes[2].ReadArguments(args);
+			Assert::AreEqual(nodes[1], args[0].GetNode());
+			Assert::AreEqual(nodes[0], std::get<0>(args[1].GetField()));
+			Assert::AreEqual("z"s, std::get<1>(args[1].GetField()));
+			nodes[3].ReadArguments(args);
+			Assert::AreEqual(nodes[2], args[0].GetNode());
+			Assert::AreEqual("x"s, std::get<1>(args[1].GetField()));
+
+			auto compacted = Repack(doc.get()).Document;
+			Assert::IsTrue(compacted.size() < file.size());
+			auto folded = Document::ReadFromData(nullptr, compacted.data(), compacted.size());
+			nodes = folded->GetAllNodes().ToList();
+			Assert::AreEqual(std::size_t{ 4 }, nodes.size());
+			nodes[3].ReadArguments(args);
+			Assert::AreEqual(nodes[2], args[0].GetNode());
+			Assert::AreEqual("x"s, std::get<1>(args[1].GetField()));
+		}
+
+		TEST_METHOD(AppendChildren)
+		{
+			auto file = Children;
+			auto doc = Document::ReadFromSegmentedData(nullptr, file.data(), file.size());
+			SegmentBuilder builder(doc.get());
+			builder.WriteNode(0, {}, {});
+			builder.WriteNode(1, {}, {});
+			builder.EndChildren();
+			Assert::ExpectException<ReaderException>([&]() { builder.EndChildren(); });
+			auto segment = builder.Finish();
+			file.insert(file.end(), segment.begin(), segment.end());
+
+			doc = Document::ReadFromSegmentedData(nullptr, file.data(), file.size());
+			auto nodes = doc->GetAllNodes().ToList();
+			Assert::AreEqual(std::size_t{ 2 }, nodes.size());
+			auto children = nodes[1].GetChildren().ToList();
+			Assert::AreEqual(std::size_t{ 1 }, children.size());
+			Assert::AreEqual("node_b"s, children[0].GetNodeType()->GetName());
+			Assert::AreEqual(nodes[1], children[0].FindParent());
+		}
+
+		TEST_METHOD(RejectReferenceIntoNode)
+		{
+			auto file = Reference;
+			auto doc = Document::ReadFromSegmentedData(nullptr, file.data(), file.size());
+			auto nodes = doc->GetAllNodes().ToList();
+			SegmentBuilder builder(doc.get());
+			auto z = builder.AddString("z");
+			auto n3 = builder.WriteNode(0, {}, { nodes[1].GetOffset(), { nodes[0].GetOffset(), z } });
+			auto n4 = builder.WriteNode(0, {}, { n3, { n3, z } });
+
+			Assert::ExpectException<ReaderException>([&]()
+				{
+					builder.WriteNode(0, {}, { nodes[1].GetOffset() + 1, { nodes[0].GetOffset(), z } });
+				});
+			Assert::ExpectException<ReaderException>([&]()
+				{
+					builder.WriteNode(0, {}, { nodes[0].GetOffset(), { n3 + 1, z } });
+				});
+			//The node being written is not an earlier node.
+			auto n5 = n4 + (n4 - n3);
+			Assert::ExpectException<ReaderException>([&]() { builder.WriteNode(0, {}, { n5, { n3, z } }); });
+
+			//Rejected nodes leave nothing behind.
+			Assert::AreEqual(n5, builder.WriteNode(0, {}, { n4, { n3, z } }));
+			auto segment = builder.Finish();
+			file.insert(file.end(), segment.begin(), segment.end());
+			doc = Document::ReadFromSegmentedData(nullptr, file.data(), file.size());
+			Assert::AreEqual(std::size_t{ 5 }, doc->GetAllNodes().ToList().size());
+		}
+	};
+}
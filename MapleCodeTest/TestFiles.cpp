@@ -31,4 +31,16 @@ namespace MapleCodeTest::TestFiles
 		0x00, 0x00, 0x04, 0x02, 0x6E, 0x00, 0x02, 0x09,
 		0x0A, 0x78, 0x00, 0x79, 0x00,
 	};
+
+	//An unused string and type, and two DAT arguments with the same payload.
+	std::vector<std::uint8_t> UnusedEntries = {
+		0x55, 0x04, 0x08, 0x06, 0x28, 0x00, 0x05, 0x0C,
+		0x13, 0x02, 0x1A, 0x00, 0x00, 0x03, 0x1E, 0x00,
+		0x00, 0x00, 0x00, 0x20, 0x24, 0x24, 0x28, 0x75,
+		0x73, 0x65, 0x64, 0x00, 0x75, 0x6E, 0x75, 0x73,
+		0x65, 0x64, 0x00, 0x74, 0x79, 0x70, 0x65, 0x5F,
+		0x61, 0x00, 0x74, 0x79, 0x70, 0x65, 0x5F, 0x62,
+		0x00, 0x03, 0x07, 0x08, 0x08, 0x01, 0x00, 0x01,
+		0x02, 0x03, 0x04, 0x01, 0x02, 0x03, 0x04,
+	};
 }
@@ -4,5 +4,5 @@
 
 namespace MapleCodeTest::TestFiles
 {
-	extern std::vector<std::uint8_t> SimpleNodes, Children, Reference;
+	extern std::vector<std::uint8_t> SimpleNodes, Children, Reference, UnusedEntries;
 }
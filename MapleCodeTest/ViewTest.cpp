@@ -0,0 +1,119 @@
+#include "pch.h"
+#include "TestFiles.h"
+#include "../MapleCode/MapleCodeView.h"
+
+using namespace MapleCode::Reader;
+using namespace MapleCodeTest::TestFiles;
+using namespace std::string_literals;
+
+namespace MapleCodeTest
+{
+	struct NodeA : NodeSchema<0, false, NodeArgumentType::U32>
+	{
+		static constexpr const char* Name = "node_a";
+	};
+
+	struct NodeB : NodeSchema<0, false, NodeArgumentType::S8, NodeArgumentType::STR, NodeArgumentType::F32>
+	{
+		static constexpr const char* Name = "node_b";
+	};
+
+	struct NodeC : NodeSchema<2, false, NodeArgumentType::DAT>
+	{
+		static constexpr const char* Name = "node_c";
+	};
+
+	struct WrongNodeA : NodeSchema<0, false, NodeArgumentType::U16>
+	{
+		static constexpr const char* Name = "node_a";
+	};
+
+	struct ParentNode : NodeSchema<0, true>
+	{
+		static constexpr const char* Name = "node_a";
+	};
+
+	struct RefNode : NodeSchema<0, false, NodeArgumentType::REF, NodeArgumentType::REFFIELD>
+	{
+		static constexpr const char* Name = "n";
+	};
+
+	struct DuplicateNode : NodeSchema<0, false, NodeArgumentType::U8>
+	{
+		static constexpr const char* Name = "n";
+	};
+
+	TEST_CLASS(ViewTest)
+	{
+	public:
+		TEST_METHOD(ViewSimpleNodes)
+		{
+			auto doc = Document::ReadFromData(nullptr, SimpleNodes.data(), SimpleNodes.size());
+			auto nodes = doc->GetAllNodes().ToList();
+			auto a = NodeBinding<NodeA>::Bind(doc.get());
+			auto b = NodeBinding<NodeB>::Bind(doc.get());
+			auto c = NodeBinding<NodeC>::Bind(doc.get());
+
+			Assert::IsTrue(a.Matches(nodes[0]));
+			Assert::IsFalse(a.Matches(nodes[1]));
+			Assert::AreEqual(10u, a.View(nodes[0]).Get<0>());
+
+			auto vb = b.View(nodes[1]);
+			Assert::AreEqual(-1, vb.Get<0>());
+			Assert::AreEqual("string"s, vb.Get<1>());
+			Assert::AreEqual(0.1f, vb.Get<2>());
+
+			auto vc = c.View(nodes[2]);
+			Assert::AreEqual("t2"s, vc.GetGeneric(1));
+			std::vector<std::uint8_t> data;
+			vc.GetData<0>(data);
+			Assert::AreEqual(std::vector<std::uint8_t>{ 0, 1, 2, 3, 4 }, data);
+
+			Assert::ExpectException<ReaderException>([&]() { a.View(nodes[1]); });
+			Assert::ExpectException<ReaderException>([&]() { NodeBinding<WrongNodeA>::Bind(doc.get()); });
+			Assert::IsFalse(NodeBinding<RefNode>::Bind(doc.get()).IsBound());
+		}
+
+		TEST_METHOD(ViewChildrenAndReferences)
+		{
+			auto doc = Document::ReadFromData(nullptr, Children.data(), Children.size());
+			auto parent = NodeBinding<ParentNode>::Bind(doc.get());
+			auto n1 = doc->GetAllNodes().ToList()[0];
+			Assert::AreEqual(n1.GetChildren().ToList(), parent.View(n1).GetChildren().ToList());
+
+			auto refDoc = Document::ReadFromData(nullptr, Reference.data(), Reference.size());
+			auto nodes = refDoc->GetAllNodes().ToList();
+			auto refs = NodeBinding<RefNode>::Bind(refDoc.get());
+			auto view = refs.View(nodes[1]);
+			Assert::AreEqual(nodes[0], view.Get<0>());
+			Assert::AreEqual(nodes[1], std::get<0>(view.Get<1>()));
+			Assert::AreEqual("y"s, std::get<1>(view.Get<1>()));
+		}
+
+		TEST_METHOD(ViewOutlivesBinding)
+		{
+			auto doc = Document::ReadFromData(nullptr, SimpleNodes.data(), SimpleNodes.size());
+			auto nodes = doc->GetAllNodes().ToList();
+			auto view = NodeBinding<NodeB>::Bind(doc.get()).View(nodes[1]);
+			Assert::AreEqual("string"s, view.Get<1>());
+			Assert::AreEqual(0.1f, view.Get<2>());
+		}
+
+		TEST_METHOD(BindDuplicateTypes)
+		{
+			//Two identical definitions of type "n" with one U8 argument.
+			std::vector<std::uint8_t> data = {
+				0x55, 0x01, 0x08, 0x04, 0x04, 0x00, 0x00, 0x02,
+				0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x05,
+				0x01, 0x07, 0x6E, 0x00, 0x01, 0x00,
+			};
+			auto doc = Document::ReadFromData(nullptr, data.data(), data.size());
+			auto nodes = doc->GetAllNodes().ToList();
+			auto binding = NodeBinding<DuplicateNode>::Bind(doc.get());
+			Assert::IsTrue(binding.IsBoundType(0));
+			Assert::IsTrue(binding.IsBoundType(1));
+			Assert::AreEqual(5u, binding.View(nodes[0]).Get<0>());
+			Assert::AreEqual(7u, binding.View(nodes[1]).Get<0>());
+		}
+	};
+}
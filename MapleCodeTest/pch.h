@@ -24,6 +24,30 @@ namespace Microsoft::VisualStudio::CppUnitTestFramework
 		return std::wstring((wchar_t*)u16str.c_str());
 	}
 
+	template<> inline std::wstring ToString<std::vector<Node>>(const std::vector<Node>& t)
+	{
+		std::wstringstream ss;
+		ss << "{ ";
+		for (auto& n : t)
+		{
+			ss << ToString(n) << " ";
+		}
+		ss << "}";
+		return ss.str();
+	}
+
+	template<> inline std::wstring ToString<std::vector<std::string>>(const std::vector<std::string>& t)
+	{
+		std::wstringstream ss;
+		ss << "{ ";
+		for (auto& str : t)
+		{
+			ss << std::wstring(str.begin(), str.end()) << " ";
+		}
+		ss << "}";
+		return ss.str();
+	}
+
 	template<> inline std::wstring ToString<std::vector<std::uint8_t>>(const std::vector<std::uint8_t>& t)
 	{
 		std::wstringstream ss;